@@ -0,0 +1,354 @@
+// Benchmarks for visualise
+// visualise.c is included directly so the benchmarks can call its functions; its main is renamed to keep ours
+#define main VisualiseMain
+#include "visualise.c"
+#undef main
+#include <time.h>
+
+// Results of benchmarks are stored here so the compiler can't drop the work that produced them
+volatile char sink;
+
+// Every measurement is written to results as one CSV line, so runs can be compared by a script to catch regressions
+FILE *results;
+const char *shortnames[] = {"char", "schar", "uchar", "short", "ushort", "int", "uint", "long", "ulong", "int128", "uint128"};
+// The kinds of input each kernel is measured with, see MakeValues
+enum {eRANDOM, eWORST};
+const char *inputnames[] = {"random", "worst"};
+
+// Returns the time in seconds since an arbitrary point, for measuring intervals
+double Now(){
+    return (double) clock() / CLOCKS_PER_SEC;
+}
+
+// Writes one measurement: "values" values of the type (or "struct" for a type of -1) took "time" seconds
+void Report(const char *kernel, int type, const char *input, long long values, double time){
+    if (time <= 0) time = 1e-9; // too quick for the clock to see
+    fprintf(results, "%s,%s,%s,%lld,%.2f,%.0f\n", kernel, type < 0 ? "struct" : shortnames[type], input,
+        values, time * 1e9 / values, values / time);
+}
+
+// Returns a random value of the type, spread over its whole range
+Value RandomValue(int type){
+    UValue r = 0;
+    for (int i = 0; i < 7; i++) r = r << 21 ^ rand(); // rand() gives at least 15 bits, often 31
+    return lowerlimit[type] + (Value) (r % (upperlimit[type] - (UValue) lowerlimit[type]));
+}
+
+// Fills values with count values of the type, either random or the worst case for the converters:
+// the value with the most decimal digits, i.e. the lower limit of signed types and the upper limit of unsigned ones
+void MakeValues(Value *values, int count, int type, int input){
+    for (int i = 0; i < count; i++)
+        values[i] = input == eRANDOM ? RandomValue(type) : lowerlimit[type] < 0 ? lowerlimit[type] : (Value) upperlimit[type];
+}
+
+// Sets up argument words the way a shell would pass the type, e.g. "unsigned" "int", and returns how many there are
+int WriteType(int type, char *s[]){
+    const char *words[][2] = {{"char"}, {"signed", "char"}, {"unsigned", "char"}, {"short"}, {"unsigned", "short"}, {"int"},
+        {"unsigned", "int"}, {"long"}, {"unsigned", "long"}, {"__int128"}, {"unsigned", "__int128"}};
+    s[0] = (char *) words[type][0];
+    if (words[type][1] == NULL) return 1;
+    s[1] = (char *) words[type][1];
+    return 2;
+}
+
+// Converts a struct of "fields" ints from decimal to binary through Solve and returns the time taken in seconds
+// The queue is filled directly, since this measures validation and conversion rather than parsing the types
+double BenchStruct(int fields){
+    int n = fields + 2;
+    char **s = malloc(n * sizeof(char *));
+    char *values = malloc(fields * 12);
+    s[0] = "";
+    s[1] = "{int;...}";
+    for (int i = 0; i < fields; i++){
+        s[i+2] = values + i*12;
+        sprintf(s[i+2], "%d", (i * 7919) - fields * 3000);
+    }
+    Queue q;
+    InitialiseQueue(&q);
+    for (int i = 0; i < fields; i++) Push(&q, i+2, eINT);
+
+    double start = Now();
+    Solve(n, s, eDEC, eBIN, &q, &out);
+    FlushOutput(&out);
+    double time = Now() - start;
+    FreeQueue(&q);
+    free(values);
+    free(s);
+    return time;
+}
+
+// Structs of growing size should take the same time per field if Solve scales linearly
+void benchStructScaling(){
+    int fields[] = {1250, 2500, 5000, 10000};
+    for (int i = 0; i < 4; i++){
+        char input[32];
+        sprintf(input, "%d-fields", fields[i]);
+        Report("Solve", eINT, input, fields[i], BenchStruct(fields[i]));
+    }
+}
+
+// Encoding values of every type into grouped binary text
+void benchEncodeBinary(){
+    int count = 1 << 16, rounds = 64;
+    Value *values = malloc(count * sizeof(Value));
+    char *text = malloc(count * 160);
+    for (int type = eCHAR; type < TYPECOUNT; type++)
+        for (int input = eRANDOM; input <= eWORST; input++){
+            MakeValues(values, count, type, input);
+            double start = Now();
+            for (int r = 0; r < rounds; r++) EncodeBinaryBatch(count, values, type, text);
+            double time = Now() - start;
+            sink = text[count * 10 - 1];
+            Report("EncodeBinary", type, inputnames[input], (long long) count * rounds, time);
+        }
+    free(values);
+    free(text);
+}
+
+// Converting values of every type into ungrouped binary strings
+void benchConvertDec(){
+    int count = 1 << 14, rounds = 64;
+    Value *values = malloc(count * sizeof(Value));
+    char binary[129];
+    for (int type = eCHAR; type < TYPECOUNT; type++)
+        for (int input = eRANDOM; input <= eWORST; input++){
+            MakeValues(values, count, type, input);
+            double start = Now();
+            for (int r = 0; r < rounds; r++)
+                for (int i = 0; i < count; i++){
+                    ConvertDec(values[i], type, binary);
+                    sink = binary[0];
+                }
+            double time = Now() - start;
+            Report("ConvertDec", type, inputnames[input], (long long) count * rounds, time);
+        }
+    free(values);
+}
+
+// Writes the nibbles of count values as NUL terminated words, the way they arrive in args, pointing nibbles at them
+void MakeNibbles(Value *values, int count, int type, char *text, char **nibbles){
+    for (int i = 0; i < count; i++) EncodeBinary(values[i], type, text + i * sizes[type] * 5);
+    for (int i = 0; i < count * sizes[type]; i++){
+        text[i*5 + 4] = '\0';
+        nibbles[i] = text + i*5;
+    }
+}
+
+// Parsing and checking the nibbles of values of every type
+void benchConvertBin(){
+    int count = 1 << 14, rounds = 64;
+    Value *values = malloc(count * sizeof(Value));
+    char *text = malloc(count * 160);
+    char **nibbles = malloc(count * 32 * sizeof(char *));
+    for (int type = eCHAR; type < TYPECOUNT; type++)
+        for (int input = eRANDOM; input <= eWORST; input++){
+            MakeValues(values, count, type, input);
+            MakeNibbles(values, count, type, text, nibbles);
+            Value sum = 0;
+            bool valid = 1;
+            double start = Now();
+            for (int r = 0; r < rounds; r++)
+                for (int i = 0; i < count; i++) sum += ConvertBin(count * sizes[type], nibbles, i * sizes[type], &valid, type);
+            double time = Now() - start;
+            sink = sum + !valid;
+            Report("ConvertBin", type, inputnames[input], (long long) count * rounds, time);
+        }
+    free(values);
+    free(nibbles);
+    free(text);
+}
+
+// Checking and converting decimal strings of values of every type
+void benchConvertDecStr(){
+    int count = 1 << 14, rounds = 64;
+    Value *values = malloc(count * sizeof(Value));
+    char *text = malloc(count * 48);
+    for (int type = eCHAR; type < TYPECOUNT; type++)
+        for (int input = eRANDOM; input <= eWORST; input++){
+            MakeValues(values, count, type, input);
+            for (int i = 0; i < count; i++) *FormatDec(values[i], type, text + i*48) = '\0';
+            Value sum = 0;
+            bool valid = 1;
+            double start = Now();
+            for (int r = 0; r < rounds; r++)
+                for (int i = 0; i < count; i++) sum += ConvertDecStr(text + i*48, &valid, type, 1);
+            double time = Now() - start;
+            sink = sum;
+            Report("ConvertDecStr", type, inputnames[input], (long long) count * rounds, time);
+        }
+    free(values);
+    free(text);
+}
+
+// Writing values of every type in decimal
+void benchFormatDec(){
+    int count = 1 << 14, rounds = 64;
+    Value *values = malloc(count * sizeof(Value));
+    char *text = malloc(count * 48);
+    for (int type = eCHAR; type < TYPECOUNT; type++)
+        for (int input = eRANDOM; input <= eWORST; input++){
+            MakeValues(values, count, type, input);
+            double start = Now();
+            for (int r = 0; r < rounds; r++)
+                for (int i = 0; i < count; i++) FormatDec(values[i], type, text + i*48);
+            double time = Now() - start;
+            sink = text[(count-1) * 48];
+            Report("FormatDec", type, inputnames[input], (long long) count * rounds, time);
+        }
+    free(values);
+    free(text);
+}
+
+// Writing values of every type in hex and octal and reading them back
+void benchRadix(){
+    int count = 1 << 14, rounds = 64;
+    Value *values = malloc(count * sizeof(Value));
+    char *text = malloc(count * 48);
+    for (int radix = eHEX; radix <= eOCT; radix++)
+        for (int type = eCHAR; type < TYPECOUNT; type++)
+            for (int input = eRANDOM; input <= eWORST; input++){
+                MakeValues(values, count, type, input);
+                const Kernels *k = &kernels[type];
+                char *(*encode)(Value, char *) = radix == eHEX ? k->encodehex : k->encodeoct;
+                bool (*parse)(const char *, size_t, Value *) = radix == eHEX ? k->parsehex : k->parseoct;
+                size_t len = encode(0, text) - text;
+                double start = Now();
+                for (int r = 0; r < rounds; r++)
+                    for (int i = 0; i < count; i++) encode(values[i], text + i*48);
+                double time = Now() - start;
+                sink = text[(count-1) * 48];
+                Report(radix == eHEX ? "EncodeHex" : "EncodeOct", type, inputnames[input], (long long) count * rounds, time);
+                Value sum = 0, value = 0;
+                start = Now();
+                for (int r = 0; r < rounds; r++)
+                    for (int i = 0; i < count; i++) sum += parse(text + i*48, len, &value) ? value : 0;
+                time = Now() - start;
+                sink = sum;
+                Report(radix == eHEX ? "ParseHex" : "ParseOct", type, inputnames[input], (long long) count * rounds, time);
+            }
+    free(values);
+    free(text);
+}
+
+// Deciding whether the args of one value of every type are binary, and of a struct of one field of each type
+void benchIsBinary(){
+    int rounds = 1 << 18;
+    Value values[TYPECOUNT];
+    char text[160 * TYPECOUNT];
+    char *s[5 + 32 * TYPECOUNT];
+    // IsBinary only reads its args, so without reading them through a volatile the calls could be hoisted out of the loop
+    char **volatile args = s;
+    for (int type = eCHAR; type < TYPECOUNT; type++)
+        for (int input = eRANDOM; input <= eWORST; input++){
+            MakeValues(values, 1, type, input);
+            s[0] = "";
+            int index = 1 + WriteType(type, s + 1);
+            MakeNibbles(values, 1, type, text, s + index);
+            int n = index + sizes[type];
+            long long count = 0;
+            double start = Now();
+            for (int r = 0; r < rounds; r++) count += IsBinary(n, args);
+            double time = Now() - start;
+            if (count != rounds) fprintf(stderr, "IsBinary rejected a binary %s\n", shortnames[type]);
+            Report("IsBinary", type, inputnames[input], rounds, time);
+        }
+    // The schema is split into words where the shell would split it
+    char *schema[] = {"", "{char;unsigned", "char;short;unsigned", "short;int;unsigned", "int;long}"};
+    int fields[] = {eCHAR, eUCHAR, eSHORT, eUSHORT, eINT, eUINT, eLONG};
+    memcpy(s, schema, sizeof(schema));
+    int n = 5;
+    for (int i = 0; i < 7; i++){
+        MakeValues(values, 1, fields[i], eRANDOM);
+        MakeNibbles(values, 1, fields[i], text + n * 5, s + n);
+        n += sizes[fields[i]];
+    }
+    long long count = 0;
+    double start = Now();
+    for (int r = 0; r < rounds; r++) count += IsBinary(n, args);
+    double time = Now() - start;
+    sink = count;
+    Report("IsBinary", -1, "structured", rounds, time);
+}
+
+// Streams "records" records of the types, given as argument words, from memory through Stream, as decimal or binary input
+// Each record holds the fields' values in order, random or worst case; the output goes to stdout, i.e. /dev/null
+void BenchStream(int words, char *s[], int count, int input, bool binary, const char *input_name, int type){
+    Plan plan;
+    if (CompilePlan(words, s, &plan) == -1) return;
+    char *text = malloc((size_t) count * plan.count * 161 + 1), *p = text;
+    Value value;
+    for (int i = 0; i < count; i++)
+        for (int j = 0; j < plan.count; j++){
+            MakeValues(&value, 1, plan.fields[j].type, input);
+            if (binary) p = EncodeBinary(value, plan.fields[j].type, p);
+            else {
+                p = FormatDec(value, plan.fields[j].type, p);
+                *p++ = j == plan.count - 1 ? '\n' : ' ';
+            }
+        }
+    double start = Now();
+    Stream(NULL, text, p - text, &plan, binary);
+    double time = Now() - start;
+    Report(binary ? "StreamBin" : "StreamDec", type, input_name, (long long) count * plan.count, time);
+    FreePlan(&plan);
+    free(text);
+}
+
+// Full runs of streaming mode, reading every type from decimal and from binary text, and a struct of all types
+void benchStream(){
+    int count = 1 << 17;
+    char *s[4] = {""};
+    for (int binary = 0; binary <= 1; binary++){
+        for (int type = eCHAR; type < TYPECOUNT; type++)
+            for (int input = eRANDOM; input <= eWORST; input++)
+                BenchStream(1 + WriteType(type, s + 1), s, count, input, binary, inputnames[input], type);
+        char *schema[] = {"", "{char;unsigned", "char;short;unsigned", "short;int;unsigned", "int;long}"};
+        BenchStream(5, schema, count / 4, eRANDOM, binary, "structured", -1);
+    }
+}
+
+// Streaming binary input that repeats the same 256 values of every type, without and with a cache of 4096 slots
+void benchCache(){
+    int count = 1 << 17;
+    char *s[4] = {""};
+    Value values[256];
+    for (int type = eCHAR; type < TYPECOUNT; type++){
+        Plan plan;
+        CompilePlan(1 + WriteType(type, s + 1), s, &plan);
+        MakeValues(values, 256, type, eRANDOM);
+        char *text = malloc((size_t) count * sizes[type] * 5 + 1), *p = text;
+        for (int i = 0; i < count; i++) p = EncodeBinary(values[rand() % 256], type, p);
+        for (int cached = 0; cached <= 1; cached++){
+            if (cached) out.cache = NewCache(4096);
+            double start = Now();
+            Stream(NULL, text, p - text, &plan, eBIN);
+            double time = Now() - start;
+            Report(cached ? "StreamBinCached" : "StreamBinRepeated", type, "repeated", count, time);
+            FreeCache(out.cache);
+            out.cache = NULL;
+        }
+        FreePlan(&plan);
+        free(text);
+    }
+}
+
+// Writes the results as CSV to the file named by the first argument, or to stderr
+int main(int argc, char *argv[]){
+    results = argc > 1 ? fopen(argv[1], "w") : stderr;
+    if (results == NULL) return 1;
+    // Conversions print their results, which would only slow the benchmarks down on a terminal
+    if (freopen("/dev/null", "w", stdout) == NULL) return 1;
+    fprintf(results, "kernel,type,input,values,ns_per_value,values_per_sec\n");
+    benchStructScaling();
+    benchEncodeBinary();
+    benchConvertDec();
+    benchConvertBin();
+    benchConvertDecStr();
+    benchFormatDec();
+    benchRadix();
+    benchIsBinary();
+    benchStream();
+    benchCache();
+    if (results != stderr) fclose(results);
+    return 0;
+}
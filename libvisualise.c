@@ -0,0 +1,137 @@
+// libvisualise, see libvisualise.h
+// visualise.c is included directly so the library uses its kernels; its main is renamed so it doesn't clash with the
+// program the library is linked into, and only the functions of libvisualise.h are exported from the shared library
+#define main VisualiseMain
+#include "visualise.c"
+#undef main
+#include "libvisualise.h"
+
+_Static_assert((int) VIS_ERANGE == eRANGE && (int) VIS_EDIGIT == eDIGIT && (int) VIS_ENIBBLES == eNIBBLES && (int) VIS_ESCHEMA == eSCHEMA,
+    "libvisualise.h numbers errors the way visualise.c does");
+
+// Tells the caller where a batch went wrong, if it asked, and returns the error negated
+long Fail(vis_fault *fault, long record, int field, int code){
+    if (fault) *fault = (vis_fault) {record, field, code};
+    return -code;
+}
+
+// Sets plan up with the fields of the schema, which go in fields
+void SchemaPlan(const vis_schema *schema, Plan *plan, Field *fields){
+    plan->count = plan->nibbles = plan->bytes = 0;
+    plan->output = -1;
+    plan->layout = eSPACED;
+    plan->errors = NULL;
+    plan->fields = fields;
+    for (int i = 0; i < schema->count; i++) AddField(plan, schema->types[i]);
+}
+
+VIS_API int vis_compile(vis_schema *schema, const char *text){
+    schema->count = 0;
+    bool braces = text[0] == '{';
+    const char *p = text + braces;
+    // Each type runs up to the next ';' or '}', its spaces dropped so that e.g. "unsigned int" becomes "unsignedint"
+    while (true){
+        char name[32];
+        size_t len = 0;
+        for (; *p && *p != ';' && *p != '}'; p++){
+            if (*p == ' ') continue;
+            if (len == sizeof(name) - 1) return -VIS_ESCHEMA;
+            name[len++] = *p;
+        }
+        name[len] = '\0';
+        int type = InputType(name, "");
+        if (type == -1 || sizes[type] > 16 || schema->count == VIS_MAX_FIELDS) return -VIS_ESCHEMA;
+        schema->types[schema->count++] = type;
+        if (*p != ';') break;
+        if (!braces) return -VIS_ESCHEMA; // only a struct has several types
+        p++;
+    }
+    // A struct ends with its '}' and nothing else does
+    if (braces ? p[0] != '}' || p[1] != '\0' : *p != '\0') return -VIS_ESCHEMA;
+    return VIS_OK;
+}
+
+VIS_API long vis_encode_batch(const vis_schema *schema, const int64_t *in, size_t n, char *out, size_t cap, vis_fault *fault){
+    Plan plan;
+    Field fields[VIS_MAX_FIELDS];
+    SchemaPlan(schema, &plan, fields);
+    if (plan.count == 0 || n % plan.count) return Fail(fault, n / (plan.count ? plan.count : 1) + 1, 0, VIS_ESCHEMA);
+    size_t record = plan.nibbles * 5 + 1, len = 0; // bytes of text in every record
+    for (size_t i = 0; i < n; i += plan.count){
+        if (cap - len < record) return Fail(fault, i / plan.count + 1, 0, VIS_ESPACE);
+        char *d = out + len;
+        for (int j = 0; j < plan.count; j++){
+            int type = fields[j].type;
+            Value value = in[i + j];
+            // Values of the 64 bit types can be anything, those of unsigned long standing for their bit pattern
+            if (sizes[type] < 16 && (value < lowerlimit[type] || value > (Value) upperlimit[type]))
+                return Fail(fault, i / plan.count + 1, j + 1, VIS_ERANGE);
+            d = fields[j].kernels->encode(value, d);
+        }
+        *d++ = '\n';
+        len = d - out;
+    }
+    return len;
+}
+
+VIS_API long vis_decode_batch(const vis_schema *schema, const char *in, size_t len, int64_t *out, size_t cap, vis_fault *fault){
+    Plan plan;
+    Field fields[VIS_MAX_FIELDS];
+    SchemaPlan(schema, &plan, fields);
+    if (plan.count == 0) return Fail(fault, 1, 0, VIS_ESCHEMA);
+    // The reader covers text that is all in memory, so it never reads a file or calls error
+    Reader r = {NULL, NULL, in, 0, len, len, 1};
+    size_t count = 0;
+    while (Fill(&r, 1)){
+        r.record++;
+        if (cap - count < (size_t) plan.count) return Fail(fault, r.record, 0, VIS_ESPACE);
+        for (int i = 0; i < plan.count; i++){
+            Value value = 0;
+            if (!ReadNibbles(&r, &plan, i, &value)) return Fail(fault, r.record, r.field, r.code);
+            out[count++] = (int64_t) value;
+        }
+    }
+    return count;
+}
+
+VIS_API const char *vis_strerror(int code){
+    if (code < 0) code = -code;
+    if (code == VIS_ESPACE) return "buffer too small";
+    return code <= VIS_ESCHEMA ? errornames[code] : "unknown error";
+}
+
+#ifdef test_libvisualise
+// Tests 1 to 10 of the library
+// Tests compiling schemas and converting batches both ways, and the errors of each
+void testLibrary(){
+    vis_schema schema;
+    vis_fault fault = {0, 0, 0};
+    char text[256];
+    int64_t values[8];
+    assert(__LINE__,vis_compile(&schema, "unsigned int") == VIS_OK && schema.count == 1 && schema.types[0] == eUINT);
+    assert(__LINE__,vis_compile(&schema, "{char;int;unsigned char}") == VIS_OK && schema.count == 3 && schema.types[2] == eUCHAR);
+    assert(__LINE__,vis_compile(&schema, "{char;float}") == -VIS_ESCHEMA && vis_compile(&schema, "char;int") == -VIS_ESCHEMA
+        && vis_compile(&schema, "{char;int") == -VIS_ESCHEMA && vis_compile(&schema, "{char}x") == -VIS_ESCHEMA);
+
+    vis_compile(&schema, "{char;int;unsigned char}");
+    int64_t in[] = {7, 10000000, 255, -1, -1, 0};
+    char *expected = "0000 0111 0000 0000 1001 1000 1001 0110 1000 0000 1111 1111 \n"
+                     "1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 0000 0000 \n";
+    assert(__LINE__,vis_encode_batch(&schema, in, 6, text, sizeof(text), NULL) == (long) strlen(expected) && !memcmp(text, expected, strlen(expected)));
+    assert(__LINE__,vis_decode_batch(&schema, expected, strlen(expected), values, 8, NULL) == 6 && !memcmp(values, in, sizeof(in)));
+    // Errors say which record and field are wrong
+    in[5] = 256;
+    assert(__LINE__,vis_encode_batch(&schema, in, 6, text, sizeof(text), &fault) == -VIS_ERANGE && fault.record == 2 && fault.field == 3);
+    assert(__LINE__,vis_encode_batch(&schema, in, 3, text, 30, &fault) == -VIS_ESPACE && vis_encode_batch(&schema, in, 4, text, 256, NULL) == -VIS_ESCHEMA);
+    assert(__LINE__,vis_decode_batch(&schema, expected, strlen(expected), values, 5, &fault) == -VIS_ESPACE && fault.record == 2);
+    assert(__LINE__,vis_decode_batch(&schema, "0000 0111 0000 0002", 19, values, 8, &fault) == -VIS_EDIGIT && fault.record == 1 && fault.field == 2);
+    assert(__LINE__,vis_decode_batch(&schema, "0000 0111 0000", 14, values, 8, &fault) == -VIS_ENIBBLES && !strcmp(vis_strerror(fault.code), "wrong nibble count"));
+}
+
+// Runs the tests of the library
+int main(){
+    testLibrary();
+    printf("All tests pass.\n");
+    return 0;
+}
+#endif
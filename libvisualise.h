@@ -0,0 +1,56 @@
+// libvisualise: the conversions of visualise as a library, for programs that convert many values in process
+// Every function is reentrant, allocates nothing and never exits; results go in buffers given by the caller
+// and errors come back as negative return values
+#ifndef LIBVISUALISE_H
+#define LIBVISUALISE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VIS_API __attribute__((visibility("default")))
+#else
+#define VIS_API
+#endif
+
+// Errors, returned negated; the first four are the ways a record can be wrong, as visualise -k describes them
+enum {VIS_OK, VIS_ERANGE, VIS_EDIGIT, VIS_ENIBBLES, VIS_ESCHEMA, VIS_ESPACE};
+
+// The most fields a schema can have
+#define VIS_MAX_FIELDS 64
+
+// A compiled schema: the types of the fields of every record, in order
+typedef struct vis_schema {
+    int count;
+    int types[VIS_MAX_FIELDS];
+} vis_schema;
+
+// Where the first wrong record of a batch is and what is wrong with it; records and fields count from 1
+typedef struct vis_fault {
+    long record;
+    int field, code;
+} vis_fault;
+
+// Compiles a schema written the way visualise takes it, e.g. "unsigned int" or "{char;int;unsigned char}"
+// Any type up to 64 bits can be used; 128 bit types don't fit the int64_t values of the batches
+// Returns VIS_OK, or -VIS_ESCHEMA if the schema is wrong
+VIS_API int vis_compile(vis_schema *schema, const char *text);
+
+// Writes n values, record after record, in binary grouped in nibbles the way visualise does, one record per line
+// n must be a whole number of records; unsigned long values are given as their bit pattern
+// Returns the number of bytes written to out, which is not NUL terminated, or a negated error:
+// -VIS_ERANGE if a value doesn't fit its type and -VIS_ESPACE if the text doesn't fit in cap bytes
+// fault, unless it is NULL, tells where the error is
+VIS_API long vis_encode_batch(const vis_schema *schema, const int64_t *in, size_t n, char *out, size_t cap, vis_fault *fault);
+
+// Reads the values of the records in the len bytes of binary text at in, as vis_encode_batch writes them
+// Records are split by counting nibbles, so any whitespace can separate them
+// Returns the number of values written to out, or a negated error: -VIS_EDIGIT or -VIS_ENIBBLES if a nibble is wrong
+// or the text ends in the middle of a record, and -VIS_ESPACE if there are more than cap values
+// fault, unless it is NULL, tells where the error is
+VIS_API long vis_decode_batch(const vis_schema *schema, const char *in, size_t len, int64_t *out, size_t cap, vis_fault *fault);
+
+// Returns a description of an error code, e.g. "bad digit"
+VIS_API const char *vis_strerror(int code);
+
+#endif
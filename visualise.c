@@ -1,135 +1,936 @@
 //Implementation of the visualise task
+// Memory mapped input, write(2) and sockets need POSIX, which -std=c11 hides unless asked for
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
 
-enum {eCHAR,eUCHAR,eINT,eUINT,eLONG};
+// A value of any type is held in a Value, which is 128 bits wide where the compiler has 128 bit integers
+// Values of unsigned types that don't fit in it, e.g. an unsigned __int128 with its top bit set, are held as their bit pattern
+#ifdef __SIZEOF_INT128__
+#define WIDE
+__extension__ typedef __int128 Value;
+__extension__ typedef unsigned __int128 UValue;
+#else
+typedef long long Value;
+typedef unsigned long long UValue;
+#endif
+#define UVALUE_MAX ((UValue) -1)
+#define VALUE_MAX ((Value) (UVALUE_MAX >> 1))
+#define VALUE_MIN (-VALUE_MAX - 1)
+
+enum {eCHAR,eSCHAR,eUCHAR,eSHORT,eUSHORT,eINT,eUINT,eLONG,eULONG,eINT128,eUINT128};
+#ifdef WIDE
+#define TYPECOUNT (eUINT128 + 1)
+#else
+#define TYPECOUNT (eULONG + 1) // the 128 bit types can't be used without compiler support for them
+#endif
 // Sizes of types are saved in nibbles, for later usage
 // Position in arrays correspond to the enums above e.g. sizes[eCHAR] is 2
-const int sizes[] = {2,2,8,8,16};
+const int sizes[] = {2,2,2,4,4,8,8,16,16,32,32};
 // Type limits
-const long long upperlimit[] = {CHAR_MAX, UCHAR_MAX, INT_MAX, UINT_MAX, LLONG_MAX};
-const long long lowerlimit[] = {CHAR_MIN,         0, INT_MIN,        0, LLONG_MIN};
+const UValue upperlimit[] = {CHAR_MAX, SCHAR_MAX, UCHAR_MAX, SHRT_MAX, USHRT_MAX, INT_MAX, UINT_MAX, LLONG_MAX, ULLONG_MAX, VALUE_MAX, UVALUE_MAX};
+const Value lowerlimit[] =  {CHAR_MIN, SCHAR_MIN,         0, SHRT_MIN,         0, INT_MIN,        0, LLONG_MIN,          0, VALUE_MIN,          0};
+
+// Text of every byte value grouped in nibbles, e.g. bytetext[7] is "0000 0111 "
+// Built by the preprocessor so a byte is encoded with a single copy instead of a loop over its bits
+#define NIBBLETEXT(n) '0'+((n)>>3&1), '0'+((n)>>2&1), '0'+((n)>>1&1), '0'+((n)&1)
+#define BYTETEXT(n) {NIBBLETEXT((n)>>4), ' ', NIBBLETEXT((n)&15), ' '}
+#define BYTETEXT16(h) BYTETEXT(h*16+0), BYTETEXT(h*16+1), BYTETEXT(h*16+2), BYTETEXT(h*16+3), \
+    BYTETEXT(h*16+4), BYTETEXT(h*16+5), BYTETEXT(h*16+6), BYTETEXT(h*16+7), BYTETEXT(h*16+8), BYTETEXT(h*16+9), \
+    BYTETEXT(h*16+10), BYTETEXT(h*16+11), BYTETEXT(h*16+12), BYTETEXT(h*16+13), BYTETEXT(h*16+14), BYTETEXT(h*16+15)
+const char bytetext[256][10] = {
+    BYTETEXT16(0), BYTETEXT16(1), BYTETEXT16(2), BYTETEXT16(3), BYTETEXT16(4), BYTETEXT16(5), BYTETEXT16(6), BYTETEXT16(7),
+    BYTETEXT16(8), BYTETEXT16(9), BYTETEXT16(10), BYTETEXT16(11), BYTETEXT16(12), BYTETEXT16(13), BYTETEXT16(14), BYTETEXT16(15)
+};
+
+// Decimal digits of every byte value followed by how many there are, e.g. dectext[42] is {'4','2',0,2}
+#define DECTEXT(n) {(n) >= 100 ? '0'+(n)/100 : (n) >= 10 ? '0'+(n)/10 : '0'+(n), \
+    (n) >= 100 ? '0'+(n)/10%10 : (n) >= 10 ? '0'+(n)%10 : 0, (n) >= 100 ? '0'+(n)%10 : 0, (n) >= 100 ? 3 : (n) >= 10 ? 2 : 1}
+#define DECTEXT16(h) DECTEXT(h*16+0), DECTEXT(h*16+1), DECTEXT(h*16+2), DECTEXT(h*16+3), \
+    DECTEXT(h*16+4), DECTEXT(h*16+5), DECTEXT(h*16+6), DECTEXT(h*16+7), DECTEXT(h*16+8), DECTEXT(h*16+9), \
+    DECTEXT(h*16+10), DECTEXT(h*16+11), DECTEXT(h*16+12), DECTEXT(h*16+13), DECTEXT(h*16+14), DECTEXT(h*16+15)
+const char dectext[256][4] = {
+    DECTEXT16(0), DECTEXT16(1), DECTEXT16(2), DECTEXT16(3), DECTEXT16(4), DECTEXT16(5), DECTEXT16(6), DECTEXT16(7),
+    DECTEXT16(8), DECTEXT16(9), DECTEXT16(10), DECTEXT16(11), DECTEXT16(12), DECTEXT16(13), DECTEXT16(14), DECTEXT16(15)
+};
+
+// Both decimal digits of every number below 100, e.g. digitpairs[7] is "07", so decimal text is made two digits per division
+#define DIGITPAIR(n) {'0'+(n)/10, '0'+(n)%10}
+#define DIGITPAIR10(h) DIGITPAIR(h*10+0), DIGITPAIR(h*10+1), DIGITPAIR(h*10+2), DIGITPAIR(h*10+3), DIGITPAIR(h*10+4), \
+    DIGITPAIR(h*10+5), DIGITPAIR(h*10+6), DIGITPAIR(h*10+7), DIGITPAIR(h*10+8), DIGITPAIR(h*10+9)
+const char digitpairs[100][2] = {
+    DIGITPAIR10(0), DIGITPAIR10(1), DIGITPAIR10(2), DIGITPAIR10(3), DIGITPAIR10(4),
+    DIGITPAIR10(5), DIGITPAIR10(6), DIGITPAIR10(7), DIGITPAIR10(8), DIGITPAIR10(9)
+};
+
+// Radixes values can be written in; decimal and binary come first so that 0 and 1 still mean decimal and binary
+// where a flag used to tell binary input apart
+enum {eDEC,eBIN,eHEX,eOCT};
+
+// Hex digits of every byte value, e.g. hextext[0xA7] is "a7", and octal digits of every 6 bit value, e.g. octtext[9] is "11"
+#define HEXDIGIT(n) ((n) < 10 ? '0' + (n) : 'a' + (n) - 10)
+#define HEXTEXT(n) {HEXDIGIT((n)>>4), HEXDIGIT((n)&15)}
+#define HEXTEXT16(h) HEXTEXT(h*16+0), HEXTEXT(h*16+1), HEXTEXT(h*16+2), HEXTEXT(h*16+3), \
+    HEXTEXT(h*16+4), HEXTEXT(h*16+5), HEXTEXT(h*16+6), HEXTEXT(h*16+7), HEXTEXT(h*16+8), HEXTEXT(h*16+9), \
+    HEXTEXT(h*16+10), HEXTEXT(h*16+11), HEXTEXT(h*16+12), HEXTEXT(h*16+13), HEXTEXT(h*16+14), HEXTEXT(h*16+15)
+const char hextext[256][2] = {
+    HEXTEXT16(0), HEXTEXT16(1), HEXTEXT16(2), HEXTEXT16(3), HEXTEXT16(4), HEXTEXT16(5), HEXTEXT16(6), HEXTEXT16(7),
+    HEXTEXT16(8), HEXTEXT16(9), HEXTEXT16(10), HEXTEXT16(11), HEXTEXT16(12), HEXTEXT16(13), HEXTEXT16(14), HEXTEXT16(15)
+};
+#define OCTTEXT(n) {'0'+((n)>>3), '0'+((n)&7)}
+#define OCTTEXT8(h) OCTTEXT(h*8+0), OCTTEXT(h*8+1), OCTTEXT(h*8+2), OCTTEXT(h*8+3), \
+    OCTTEXT(h*8+4), OCTTEXT(h*8+5), OCTTEXT(h*8+6), OCTTEXT(h*8+7)
+const char octtext[64][2] = {OCTTEXT8(0), OCTTEXT8(1), OCTTEXT8(2), OCTTEXT8(3), OCTTEXT8(4), OCTTEXT8(5), OCTTEXT8(6), OCTTEXT8(7)};
+// The value of every character as a hex digit, or -1 if it isn't one
+#define HEXVALUE(c) ((c) >= '0' && (c) <= '9' ? (c) - '0' : (c) >= 'a' && (c) <= 'f' ? (c) - 'a' + 10 : \
+    (c) >= 'A' && (c) <= 'F' ? (c) - 'A' + 10 : -1)
+#define HEXVALUE16(h) HEXVALUE(h*16+0), HEXVALUE(h*16+1), HEXVALUE(h*16+2), HEXVALUE(h*16+3), \
+    HEXVALUE(h*16+4), HEXVALUE(h*16+5), HEXVALUE(h*16+6), HEXVALUE(h*16+7), HEXVALUE(h*16+8), HEXVALUE(h*16+9), \
+    HEXVALUE(h*16+10), HEXVALUE(h*16+11), HEXVALUE(h*16+12), HEXVALUE(h*16+13), HEXVALUE(h*16+14), HEXVALUE(h*16+15)
+const signed char hexvalue[256] = {
+    HEXVALUE16(0), HEXVALUE16(1), HEXVALUE16(2), HEXVALUE16(3), HEXVALUE16(4), HEXVALUE16(5), HEXVALUE16(6), HEXVALUE16(7),
+    HEXVALUE16(8), HEXVALUE16(9), HEXVALUE16(10), HEXVALUE16(11), HEXVALUE16(12), HEXVALUE16(13), HEXVALUE16(14), HEXVALUE16(15)
+};
+
+#ifdef __SSSE3__
+// For the vectorised encoder: the 80 characters of a 64 bit value grouped in nibbles, position p being
+// bit encodemask[p] of byte encodebyte[p] (little endian), or a space where encodemask[p] is 0
+#define ENCODEBYTE(p) 7 - (p)/10
+#define ENCODEMASK(p) ((p)%10 == 4 || (p)%10 == 9 ? 0 : (p)%10 < 4 ? 1 << (7 - (p)%10) : 1 << (8 - (p)%10))
+#define ENCODEBASE(p) ((p)%10 == 4 || (p)%10 == 9 ? ' ' : '0')
+#define ENCODE10(X,p) X(p), X(p+1), X(p+2), X(p+3), X(p+4), X(p+5), X(p+6), X(p+7), X(p+8), X(p+9)
+#define ENCODE80(X) ENCODE10(X,0), ENCODE10(X,10), ENCODE10(X,20), ENCODE10(X,30), \
+    ENCODE10(X,40), ENCODE10(X,50), ENCODE10(X,60), ENCODE10(X,70)
+const unsigned char encodebyte[80] = {ENCODE80(ENCODEBYTE)};
+const unsigned char encodemask[80] = {ENCODE80(ENCODEMASK)};
+const unsigned char encodebase[80] = {ENCODE80(ENCODEBASE)};
+#endif
 
 // each element holds the type of the value we entered and 
 // index, which represents the starting index in *args[] of the value the element represents
 // e.g. for input: char 0000 0000 type is eCHAR and index is 2; Due to knowing the size of Char in nibbles, we can go up to args[3] easily
 struct queueelem {
     int type, index;
-    struct queueelem *next;
 };
 typedef struct queueelem Elem;
+// The queue keeps its elements in one array, elems[front] to elems[back-1], instead of allocating each one
+// The array is reused once the queue is emptied and only grows when a record has more values than it can hold
 struct thequeue {
-    Elem *front;
-    Elem *back;
+    Elem *elems;
+    int front, back, cap;
 };
 typedef struct thequeue Queue;
 
+// The conversion kernels of one type, each specialised for it, see KERNELS
+struct kernels {
+    char *(*encode)(Value value, char *d);
+    char *(*encodebatch)(int count, const Value values[count], char *d);
+    char *(*formatdec)(Value value, char *d);
+    char *(*encodehex)(Value value, char *d);
+    char *(*encodeoct)(Value value, char *d);
+    bool (*parsedec)(const char *s, size_t len, Value *value);
+    bool (*parsehex)(const char *s, size_t len, Value *value);
+    bool (*parseoct)(const char *s, size_t len, Value *value);
+    bool (*parsebinary)(char *s[], Value *value);
+    bool (*parsegrouped)(const char *text, Value *value);
+    Value (*loadraw)(const unsigned char *p, bool big);
+};
+typedef struct kernels Kernels;
+
+// A compiled list of input types, built once and reused for every record with the same types
+// Each field holds its type, its width in nibbles and the offset in nibbles of its first nibble in a binary record
+// e.g. {char;int} becomes {eCHAR,2,0},{eINT,8,2} and a binary record of it has 10 nibbles
+// For raw records, byteoffset is where the field starts in a record of "bytes" bytes, packed unless AlignPlan was used
+// kernels are the converters for the field's type, picked once when the field is added
+// textwidth is the length of the longest text of a value of the field in the output radix, see LayoutPlan
+struct field {
+    int type, width, offset, byteoffset, textwidth;
+    const Kernels *kernels;
+};
+typedef struct field Field;
+// output is the radix values are written in, or -1 for the usual one: decimal for binary input and binary for any other
+// errors is where wrong records are described when conversion goes on past them, stdout to put them in the output
+// in place of the records; if it's NULL the first wrong record stops everything
+// layout is how streaming mode lays values out, see LayoutPlan
+struct plan {
+    int count, nibbles, bytes, output, layout;
+    Field *fields;
+    FILE *errors;
+};
+typedef struct plan Plan;
+
+// Layouts of the output of streaming mode: values each followed by a space, as visualise has always written them,
+// one value per line, columns separated by commas or tabs, and fixed width records
+enum {eSPACED,eLINES,eCSV,eTSV,eFIXED};
+
+// Values written before can be kept in a cache, so a value that comes again is copied instead of being converted again
+// Each slot holds the text of one value of one type in one radix, followed by a space; len is 0 for an empty slot
+#define CACHETEXT 45 // the longest text, of a 128 bit value in octal, and its space
+#define CACHEPROBES 4
+#define MAXSLOTS (1L << 24) // the most slots -m can ask for, a GiB of cache
+struct slot {
+    Value value;
+    unsigned char type, radix, len;
+    char text[CACHETEXT];
+};
+typedef struct slot Slot;
+
+// The cache has a fixed number of slots, a power of two; a value is looked for in the CACHEPROBES slots from the one
+// it hashes to, and replaces the first of them when they are all taken
+// hits and misses count the values found and not found, for choosing the size of the cache
+struct cache {
+    Slot *slots;
+    size_t mask;
+    long long hits, misses;
+};
+typedef struct cache Cache;
+
+// Output is collected in one growing buffer and written out in large blocks instead of one printf per character
+// len is the number of bytes waiting to be written, cap the size of the allocated block
+// Values are written through cache when there is one
+struct outbuffer {
+    char *data;
+    size_t len, cap;
+    Cache *cache;
+};
+typedef struct outbuffer Output;
+Output out = {NULL, 0, 0, NULL};
+
+// What can be wrong with a record in streaming mode
+enum {eOK,eRANGE,eDIGIT,eNIBBLES,eSCHEMA};
+const char *errornames[] = {"no error", "value out of range", "bad digit", "wrong nibble count", "record does not match the schema"};
+
+// Where a wrong record is and what is wrong with it; records and fields count from 1, a field of 0 being the whole record
+struct fault {
+    long record;
+    int field, code;
+};
+typedef struct fault Fault;
+
+// A piece of text that is not NUL terminated, e.g. a value in the middle of the input
+struct view {
+    const char *s;
+    size_t len;
+};
+typedef struct view View;
+
+// Input for streaming mode is read in blocks of READSIZE bytes into block, which grows while a single token fills it,
+// and split into whitespace separated tokens
+// A reader with no file covers input that is already in memory, e.g. a memory mapped file, buf pointing at all of it
+// buf is never written to, so tokens are handed out as views of it
+// record counts the records started so far, and field and code tell where and what was wrong in the last wrong one
+#define READSIZE (1 << 16)
+#define FLUSHSIZE (1 << 16)
+#define OUTALIGN 4096 // output buffers are page aligned
+struct reader {
+    FILE *f;
+    char *block;
+    const char *buf;
+    size_t pos, len, size;
+    bool eof;
+    long record;
+    int field, code;
+};
+typedef struct reader Reader;
+
+// With several threads the input is split into chunks of whole records of about CHUNKSIZE bytes,
+// each converted on its own into its own output buffer; ok becomes 0 if the chunk has a wrong record
+// data points at the records, either in buf, which holds size bytes read from the input, or in a memory mapped file
+// first is the number of records before the chunk and records the number in it, which is only counted if more follow;
+// wrong counts its wrong records, described in errors unless they go in the output, and fault tells about the first one
+#define CHUNKSIZE (1 << 18)
+#define MAXTHREADS 256 // the most threads -j can ask for
+struct chunk {
+    const char *data;
+    size_t len;
+    char *buf;
+    size_t size;
+    Output out;
+    bool ok;
+    long first, records, wrong;
+    Output errors;
+    Fault fault;
+    double seconds; // how long converting it took, only measured with --stats
+};
+typedef struct chunk Chunk;
+
+#ifndef _WIN32
+// A pool of threads converting chunks while the thread that started them reads the input and writes the output
+// chunks is a bounded queue of count slots used in turn: queued chunks have been handed to the workers, next is the
+// first of them no worker has taken yet, and a slot is reused once its chunk has been written; done[i] tells that the
+// chunk in slot i is converted, and stop tells the workers to finish
+// With -m every worker writes through a cache of its own, caches holding one per thread; workers counts those started
+struct pool {
+    Chunk *chunks;
+    bool *done;
+    int count;
+    Plan *plan;
+    int radix;
+    long queued, next;
+    bool stop;
+    Cache **caches;
+    int workers;
+    pthread_mutex_t lock;
+    pthread_cond_t work, finished;
+};
+typedef struct pool Pool;
+#endif
+
+// Counters and timers of streaming mode, kept only with --stats so that without it each stage pays a single test of
+// stats per block of input or output, never one per value
+// Times are in seconds: compiling the schema, reading the input and splitting it into chunks, converting (parsing,
+// checking and formatting values, which one kernel does in one pass) and writing the output
+// latency[i] counts the blocks of output (chunks with threads) that took less than 2^i microseconds to convert
+// errors counts the wrong records by what is wrong with them, from several threads
+#define LATENCYBUCKETS 32
+struct stats {
+    double start, lap, schema, read, write;
+    long long bytesin, bytesout, records, wrong;
+    atomic_llong errors[eSCHEMA + 1];
+    long long latency[LATENCYBUCKETS];
+};
+typedef struct stats Stats;
+Stats *stats = NULL;
+
 // Definitions for these functions start at line 270
 void InitialiseQueue(Queue *s);
-void Push(Queue *q, int type, int index);
-int Pop(Queue *q, int *type, int *index);    
+void ReserveQueue(Queue *q, int count);
+void FreeQueue(Queue *q);
+void Push(Queue *q, int index, int type);
+int Pop(Queue *q, int *index, int *type);    
 bool QueueEmpty(Queue *q);
-void printbinary(char *s); // Prints binary value grouped in nibbles
 void error(); // Terminates program prematurely and prints error message
+void OutReserve(Output *o, size_t extra); // Makes room in an output buffer
+void OutStr(Output *o, const char *s, size_t len); // Appends bytes to an output buffer
+void OutBinary(Output *o, Value value, int type); // Appends a value in binary, grouped in nibbles
+void OutDec(Output *o, Value value, int type); // Appends a value in decimal
+void OutValue(Output *o, const Kernels *k, Value value, int radix, int width); // Appends a value in any radix
+void FlushOutput(Output *o); // Writes everything in an output buffer to stdout
+double Seconds(); // Reads a clock for --stats
+void FreePlan(Plan *plan); // Frees the fields of a compiled plan
+bool IsSpace(char c); // Checks for a character separating values in streaming mode
 
-// Converts string to a decimal integer
-// "valid" becomes equal to 0 if we encounter an input error
-long long ConvertDecStr(char *s, bool *valid, int type, bool testing){
-    *valid = true;
-    long long value = atoll(s);
+// The generic kernels below take the type as an argument and are only called with a constant one, by the kernels
+// specialised for each type; they are always inlined into them, so the type becomes a constant they are optimised for
+#if defined(__GNUC__) || defined(__clang__)
+#define KERNEL static inline __attribute__((always_inline))
+#else
+#define KERNEL static inline
+#endif
 
-    //Check if by converting value back to a string it is equal to the initial string, thus the input being valid
-    char test[80];
-    sprintf(test,"%lld",value);
-    if (strcmp(s,test)) *valid = 0;
-    if (value>upperlimit[type] || value<lowerlimit[type]) *valid = 0;
+// Reads 8 characters into one word, the first character in the lowest byte
+uint64_t Load8(const char *s){
+    uint64_t x = 0;
+    for (int i = 0; i < 8; i++) x |= (uint64_t) (unsigned char) s[i] << (8*i);
+    return x;
+}
 
-    // Parameter "testing" tells the function if we're testing, so it doesn't terminate the program prematurely
-    if (!(*valid) && !testing) error();
-    return value;
+// Returns 1 if all 8 characters in x are digits: each byte must be 0x30 to 0x39 both before and after adding 6
+bool EightDigits(uint64_t x){
+    return (x & 0xF0F0F0F0F0F0F0F0) == 0x3030303030303030
+        && ((x + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) == 0x3030303030303030;
 }
 
-// Takes decimal value and type and puts its binary representation in the string
-void ConvertDec(long long value, int type, char *binary){
-    // Length of the representation is equal to the number of nibbles for each type times 4
-    int length = sizes[type]*4;
-    bool negative = false;
+// Returns the number written by the 8 digits in x, combining pairs of digits, then pairs of those, then the two halves
+uint32_t EightDigitValue(uint64_t x){
+    x -= 0x3030303030303030;
+    x = x * 10 + (x >> 8);
+    x = ((x & 0x000000FF000000FF) * (100 + (1000000ULL << 32)) + ((x >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32))) >> 32;
+    return x;
+}
 
-    // Initialize array
-    for (int i = 0; i < length; i++)
-        binary[i] = '0';
+// Parses the len characters at s as a decimal value of the given type, checking the digits, the sign,
+// leading zeros and the type limits in the same pass
+// *value gets the number written by the digits before the first wrong character, saturated at the 64 bit limits
+// of the type's signedness, or at the limits of Value for the 128 bit types
+// Returns 0 if the input is not exactly a valid value of the type
+#ifdef WIDE
+KERNEL bool ParseDecWide(const char *s, size_t len, int type, Value *value);
+#endif
+KERNEL bool ParseDecOf(const char *s, size_t len, int type, Value *value){
+#ifdef WIDE
+    if (sizes[type] > 16) return ParseDecWide(s, len, type, value);
+#endif
+    const char *p = s, *end = s + len;
+    bool negative = p < end && *p == '-';
+    if (negative) p++;
+    const char *digits = p;
 
-    // Check if value is negative
-    // Adding 1 from the initial value then multiplying it by (-1) assures us that by inverting the bits(excluding the MSB) of the new value
-    // we will get the initial one in binary
-    // e.g if value == -72 =>  value becomes 71. By converting 71 to binary then inverting the bits(apart from the MSB) we will get the representation of -72
-    if (value < 0) {
-        negative = true;
-        value++;
-        value *= -1;
+    // At most 20 digits are added up, as many as 64 bits can hold; the first 19 always fit and the 20th is checked
+    // Any more are only counted, the value being too large anyway
+    unsigned long long m = 0;
+    bool overflow = 0;
+    while (end - p >= 8 && p - digits <= 11 && EightDigits(Load8(p))){
+        m = m * 100000000 + EightDigitValue(Load8(p));
+        p += 8;
+    }
+    while (p < end && *p >= '0' && *p <= '9'){
+        int digit = *p - '0';
+        if (p - digits < 19) m = m * 10 + digit;
+        else if (p - digits == 19 && m <= (ULLONG_MAX - digit) / 10) m = m * 10 + digit;
+        else overflow = 1;
+        p++;
     }
+    long count = p - digits;
 
-    int i=length-1; // Put values in string from right to left
-    while(value){
-        binary[i] = value%2 + '0';
-        i--;
-        value = value >> 1;
+    // The largest magnitude of the type; computed in unsigned arithmetic so LLONG_MIN doesn't overflow
+    unsigned long long limit = negative ? 0ULL - (unsigned long long) lowerlimit[type] : (unsigned long long) upperlimit[type];
+    bool valid = p == end && count > 0 && !overflow && m <= limit;
+    if (count > 1 && *digits == '0') valid = 0; // leading zeros
+    if (negative && m == 0) valid = 0; // "-0"
+
+    if (overflow) m = ULLONG_MAX;
+    if (negative) *value = m > (unsigned long long) LLONG_MAX + 1 ? LLONG_MIN : (long long) (0ULL - m);
+    else *value = lowerlimit[type] < 0 && m > LLONG_MAX ? LLONG_MAX : (Value) m;
+    return valid;
+}
+
+#ifdef WIDE
+// ParseDecOf for the 128 bit types, adding up to 39 digits in 128 bits
+KERNEL bool ParseDecWide(const char *s, size_t len, int type, Value *value){
+    const char *p = s, *end = s + len;
+    bool negative = p < end && *p == '-';
+    if (negative) p++;
+    const char *digits = p;
+
+    UValue m = 0;
+    bool overflow = 0;
+    while (end - p >= 8 && p - digits <= 30 && EightDigits(Load8(p))){
+        m = m * 100000000 + EightDigitValue(Load8(p));
+        p += 8;
     }
-    if (negative){ //invert bits if the initial value was negative
-    for (int i = 1; i < length; i++)
-        if(binary[i]=='0') binary[i] = '1';
-                      else binary[i] = '0';
+    while (p < end && *p >= '0' && *p <= '9'){
+        int digit = *p - '0';
+        if (p - digits < 38) m = m * 10 + digit;
+        else if (p - digits == 38 && m <= (UVALUE_MAX - digit) / 10) m = m * 10 + digit;
+        else overflow = 1;
+        p++;
     }
-    if (negative) binary[0] = '1';
-    binary[length] = '\0';
+    long count = p - digits;
 
-}
+    UValue limit = negative ? 0 - (UValue) lowerlimit[type] : upperlimit[type];
+    bool valid = p == end && count > 0 && !overflow && m <= limit;
+    if (count > 1 && *digits == '0') valid = 0;
+    if (negative && m == 0) valid = 0;
 
-//Converts binary to decimal
-long long ConvertBin(int n, char *s[n], int index, int type){
-    long long value = 0,p = 0;
-    bool unsign = 0;
-    if (type == eUCHAR || type == eUINT) unsign = 1;
-    // Initialize the value holds 2^n, weight of each bit
-    p = upperlimit[type]>>1;
-    p++;
+    if (overflow) m = UVALUE_MAX;
+    if (negative) *value = m > (UValue) VALUE_MAX + 1 ? VALUE_MIN : (Value) (0 - m);
+    else *value = lowerlimit[type] < 0 && m > (UValue) VALUE_MAX ? VALUE_MAX : (Value) m;
+    return valid;
+}
+#endif
 
-    if (s[index][0] == '1' && !unsign) value = lowerlimit[type]; //we have a negative value
-    // convert the most significant nibble first to exclude the first bit if the value is signed
-    for (int j = 0; j < 4; j++)
-        if (j!=0 || unsign){
-        value += p * (s[index][j] - '0'); 
-        p >>= 1;
+// Writes the "bytes" lowest bytes of bits in binary, grouped in nibbles with a space after each of them, starting at d
+// Returns a pointer to the end of the text, which is not NUL terminated
+KERNEL char *EncodeWord(unsigned long long bits, int bytes, char *d){
+#ifdef __SSSE3__
+    if (bytes >= 4){
+        // The text is the tail of the 80 characters of a 64 bit value, written 16 characters at a time
+        // Each lane picks the byte holding its bit, isolates the bit and turns it into '0'/'1', or keeps its space
+        // The last block is moved back to end exactly at the last character, overlapping the one before it
+        int start = 80 - bytes*10;
+        __m128i v = _mm_cvtsi64_si128(bits);
+        for (int k = start; ; k += 16){
+            if (k > 64) k = 64;
+            __m128i mask = _mm_loadu_si128((const __m128i *) (encodemask + k));
+            __m128i b = _mm_and_si128(_mm_shuffle_epi8(v, _mm_loadu_si128((const __m128i *) (encodebyte + k))), mask);
+            __m128i one = _mm_and_si128(_mm_cmpeq_epi8(b, mask), _mm_min_epu8(mask, _mm_set1_epi8(1)));
+            _mm_storeu_si128((__m128i *) (d + k - start), _mm_add_epi8(_mm_loadu_si128((const __m128i *) (encodebase + k)), one));
+            if (k == 64) break;
         }
+        return d + bytes*10;
+    }
+#endif
+    for (int shift = (bytes-1) * 8; shift >= 0; shift -= 8){
+        memcpy(d, bytetext[(bits >> shift) & 0xFF], 10);
+        d += 10;
+    }
+    return d;
+}
 
-    for (int i = index+1; i < index+sizes[type]; i++){
-        for (int j = 0; j < 4; j++){
-            value += p * (s[i][j] - '0');
-            p >>= 1;
+// Writes the binary representation of value, grouped in nibbles with a space after each of them, starting at d
+// Works on the two's complement bit pattern, so negative values need no special case
+// 128 bit values are written as two 64 bit halves
+// Returns a pointer to the end of the text, which is not NUL terminated
+KERNEL char *EncodeBinaryOf(Value value, int type, char *d){
+#ifdef WIDE
+    if (sizes[type] > 16) d = EncodeWord((UValue) value >> 64, sizes[type]/2 - 8, d);
+#endif
+    return EncodeWord(value, sizes[type] > 16 ? 8 : sizes[type]/2, d);
+}
+
+// Writes value in decimal starting at d, with a '-' if it is negative and its type is signed
+// Values of unsigned types are written from their bit pattern, so the ones that don't fit in a Value come out right
+// Returns a pointer to the end of the text, which is not NUL terminated
+KERNEL char *FormatDecOf(Value value, int type, char *d){
+    UValue m = value;
+    if (lowerlimit[type] < 0 && value < 0){
+        *d++ = '-';
+        m = 0 - m;
+    }
+    if (sizes[type] == 2){
+        // 8 bit values are copied from a table instead of being divided digit by digit
+        memcpy(d, dectext[(unsigned char) m], 3);
+        return d + dectext[(unsigned char) m][3];
+    }
+    char digits[40];
+    int i = 40;
+#ifdef WIDE
+    // Values of more than 64 bits are cut into parts of 19 digits, so most digits are made with 64 bit divisions
+    while (sizes[type] > 16 && m > ULLONG_MAX){
+        unsigned long long part = m % 10000000000000000000ULL;
+        m /= 10000000000000000000ULL;
+        for (int j = 0; j < 9; j++, part /= 100) memcpy(digits + (i -= 2), digitpairs[part % 100], 2);
+        digits[--i] = '0' + part;
+    }
+#endif
+    // Digits are made from the right, two at a time
+    unsigned long long rest = m;
+    for (; rest >= 100; rest /= 100) memcpy(digits + (i -= 2), digitpairs[rest % 100], 2);
+    if (rest >= 10) memcpy(digits + (i -= 2), digitpairs[rest], 2);
+    else digits[--i] = '0' + rest;
+    memcpy(d, digits + i, 40 - i);
+    return d + 40 - i;
+}
+
+// Takes decimal value and type and puts its binary representation in the string, without grouping
+void ConvertDec(Value value, int type, char *binary){
+    UValue bits = value;
+    for (int shift = (sizes[type]/2 - 1) * 8; shift >= 0; shift -= 8){
+        const char *text = bytetext[(bits >> shift) & 0xFF];
+        memcpy(binary, text, 4);
+        memcpy(binary + 4, text + 5, 4);
+        binary += 8;
+    }
+    *binary = '\0';
+}
+
+// Returns the value of the 4 '0'/'1' characters at s, or -1 if any of them is something else
+int PackNibble(const char *s){
+    uint32_t w = (uint32_t) (unsigned char) s[0] | (uint32_t) (unsigned char) s[1] << 8
+               | (uint32_t) (unsigned char) s[2] << 16 | (uint32_t) (unsigned char) s[3] << 24;
+    w ^= 0x30303030; // '0' becomes 0 and '1' becomes 1 in every byte
+    if (w & 0xFEFEFEFE) return -1;
+    // The multiplication moves the lowest bit of each byte next to each other in the top byte, first character highest
+    return (w * 0x08040201) >> 24;
+}
+
+// Returns the value of a nibble written as exactly 4 characters of '0'/'1', or -1 if s is anything else
+// All 4 characters are checked and packed together instead of one at a time
+int ParseNibble(const char *s){
+    if (!s[0] || !s[1] || !s[2] || !s[3] || s[4]) return -1; // checked in order, so nothing past the end of s is read
+    return PackNibble(s);
+}
+
+// Turns the bits of a value of the given type into a Value, extending the sign bit for signed types
+// Values of up to 64 bits are extended in 64 bits and then converted, which extends them the rest of the way
+KERNEL Value SignExtend(UValue bits, int type){
+    int width = sizes[type] * 4;
+    if (width > 64) return (Value) bits;
+    unsigned long long low = bits;
+    if (lowerlimit[type] < 0){
+        if (width < 64 && (low >> (width-1) & 1)) low |= ~0ULL << width;
+        return (long long) low;
+    }
+    return low;
+}
+
+// Puts the 64 bit halves of a 128 bit pattern together
+KERNEL UValue JoinWords(unsigned long long high, unsigned long long low){
+#ifdef WIDE
+    return (UValue) high << 64 | low;
+#else
+    return low;
+#endif
+}
+
+// Parses "count" nibbles starting at s[0], at most 16, into *bits
+// Returns 0 if one of them isn't made of exactly 4 '0'/'1' characters
+KERNEL bool ParseNibbles(char *s[], int count, unsigned long long *bits){
+    unsigned long long b = 0;
+    for (int i = 0; i < count; i++){
+        int nibble = ParseNibble(s[i]);
+        if (nibble < 0) return 0;
+        b = b << 4 | nibble;
+    }
+    *bits = b;
+    return 1;
+}
+
+// Parses the sizes[type] nibbles starting at s[0] into *value, checking every character on the way
+// Returns 0 if one of them isn't made of exactly 4 '0'/'1' characters
+KERNEL bool ParseBinaryOf(char *s[], int type, Value *value){
+    unsigned long long high = 0, low = 0;
+    int nibbles = sizes[type];
+    if (nibbles > 16){
+        if (!ParseNibbles(s, nibbles - 16, &high)) return 0;
+        s += nibbles - 16;
+        nibbles = 16;
+    }
+    if (!ParseNibbles(s, nibbles, &low)) return 0;
+    *value = SignExtend(JoinWords(high, low), type);
+    return 1;
+}
+
+// Parses "count" nibbles at the start of text, at most 16, each followed by exactly one whitespace character, into *bits
+KERNEL bool ParseGroupedWord(const char *text, int count, unsigned long long *bits){
+    unsigned long long b = 0;
+    for (int i = 0; i < count; i++, text += 5){
+        if (!IsSpace(text[4])) return 0;
+        int nibble = PackNibble(text);
+        if (nibble < 0) return 0;
+        b = b << 4 | nibble;
+    }
+    *bits = b;
+    return 1;
+}
+
+// Parses the sizes[type] nibbles at the start of text, each followed by exactly one whitespace character,
+// the layout visualise itself writes; returns 0 if the text is laid out in any other way or isn't binary
+// Nibbles sit at fixed offsets, so each is loaded and checked as a whole without looking for where tokens end
+KERNEL bool ParseGroupedOf(const char *text, int type, Value *value){
+    unsigned long long high = 0, low = 0;
+    int nibbles = sizes[type];
+    if (nibbles > 16){
+        if (!ParseGroupedWord(text, nibbles - 16, &high)) return 0;
+        text += (nibbles - 16) * 5;
+        nibbles = 16;
+    }
+    if (!ParseGroupedWord(text, nibbles, &low)) return 0;
+    *value = SignExtend(JoinWords(high, low), type);
+    return 1;
+}
+
+// Returns the "bytes" bytes at p, at most 8, as a number, in little or big endian order
+KERNEL unsigned long long LoadWord(const unsigned char *p, int bytes, bool big){
+    unsigned long long bits = 0;
+    for (int i = 0; i < bytes; i++) bits |= (unsigned long long) p[big ? bytes-1-i : i] << (8*i);
+    return bits;
+}
+
+// Returns the value of a field of the given type stored in raw bytes at p, in little or big endian order
+// 128 bit fields are loaded as two 64 bit halves, the high one first if big endian
+KERNEL Value LoadRawOf(const unsigned char *p, int type, bool big){
+    int bytes = sizes[type] / 2;
+    if (bytes > 8) return SignExtend(JoinWords(LoadWord(big ? p : p + 8, 8, big), LoadWord(big ? p + 8 : p, 8, big)), type);
+    return SignExtend(LoadWord(p, bytes, big), type);
+}
+
+// Writes the "bytes" lowest bytes of bits as hex digits starting at d, two at a time
+KERNEL char *HexWord(unsigned long long bits, int bytes, char *d){
+    for (int shift = (bytes-1) * 8; shift >= 0; shift -= 8, d += 2) memcpy(d, hextext[(bits >> shift) & 0xFF], 2);
+    return d;
+}
+
+// Writes the bit pattern of value in hex after "0x", with two digits for every byte of its type, e.g. "0xff" for a char of -1
+// Returns a pointer to the end of the text, which is not NUL terminated
+KERNEL char *EncodeHexOf(Value value, int type, char *d){
+    *d++ = '0';
+    *d++ = 'x';
+#ifdef WIDE
+    if (sizes[type] > 16) d = HexWord((UValue) value >> 64, sizes[type]/2 - 8, d);
+#endif
+    return HexWord(value, sizes[type] > 16 ? 8 : sizes[type]/2, d);
+}
+
+// Writes the bit pattern of value in octal after a '0', with as many digits as the widest value of its type has,
+// e.g. "0377" for a char of -1; digits are written two at a time, after the first one if there is an odd number of them
+// Returns a pointer to the end of the text, which is not NUL terminated
+KERNEL char *EncodeOctOf(Value value, int type, char *d){
+    int width = sizes[type] * 4, digits = (width + 2) / 3;
+    *d++ = '0';
+    if (width > 64){
+        UValue bits = value;
+        if (digits % 2) *d++ = '0' + (bits >> 3*--digits & 7);
+        for (; digits > 0; digits -= 2, d += 2) memcpy(d, octtext[bits >> 3*(digits-2) & 63], 2);
+        return d;
+    }
+    unsigned long long bits = value;
+    if (width < 64) bits &= (1ULL << width) - 1;
+    if (digits % 2) *d++ = '0' + (bits >> 3*--digits & 7);
+    for (; digits > 0; digits -= 2, d += 2) memcpy(d, octtext[bits >> 3*(digits-2) & 63], 2);
+    return d;
+}
+
+// Reads "count" hex digits at s, at most 16, into *bits; returns 0 if one of them isn't a hex digit
+KERNEL bool HexDigits(const char *s, size_t count, unsigned long long *bits){
+    unsigned long long b = 0;
+    for (size_t i = 0; i < count; i++){
+        int digit = hexvalue[(unsigned char) s[i]];
+        if (digit < 0) return 0;
+        b = b << 4 | digit;
+    }
+    *bits = b;
+    return 1;
+}
+
+// Parses the len characters at s as the bit pattern of a value of the given type written in hex, with or without "0x"
+// Leading zeros are allowed, but there can't be more other digits than the type has nibbles
+// Returns 0 if the input is not exactly such a value
+KERNEL bool ParseHexOf(const char *s, size_t len, int type, Value *value){
+    if (len > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')){
+        s += 2;
+        len -= 2;
+    }
+    while (len > 1 && *s == '0'){
+        s++;
+        len--;
+    }
+    if (len == 0 || len > (size_t) sizes[type]) return 0;
+    unsigned long long high = 0, low = 0;
+    size_t split = len > 16 ? len - 16 : 0;
+    if (!HexDigits(s, split, &high) || !HexDigits(s + split, len - split, &low)) return 0;
+    *value = SignExtend(JoinWords(high, low), type);
+    return 1;
+}
+
+// Parses the len characters at s as the bit pattern of a value of the given type written in octal, with or without
+// a leading '0' or "0o"; the value must fit in the bits of the type
+// Returns 0 if the input is not exactly such a value
+KERNEL bool ParseOctOf(const char *s, size_t len, int type, Value *value){
+    if (len > 2 && s[0] == '0' && (s[1] == 'o' || s[1] == 'O')){
+        s += 2;
+        len -= 2;
+    }
+    while (len > 1 && *s == '0'){
+        s++;
+        len--;
+    }
+    int width = sizes[type] * 4;
+    size_t digits = (width + 2) / 3;
+    // The first of the most digits a value can have only holds the bits left over by the others
+    if (len == 0 || len > digits || (len == digits && *s - '0' >= 1 << (width - 3*(digits-1)))) return 0;
+    if (width > 64){
+        UValue bits = 0;
+        for (size_t i = 0; i < len; i++){
+            if (s[i] < '0' || s[i] > '7') return 0;
+            bits = bits << 3 | (s[i] - '0');
         }
+        *value = SignExtend(bits, type);
+        return 1;
+    }
+    unsigned long long bits = 0;
+    for (size_t i = 0; i < len; i++){
+        if (s[i] < '0' || s[i] > '7') return 0;
+        bits = bits << 3 | (s[i] - '0');
     }
+    *value = SignExtend(bits, type);
+    return 1;
+}
+
+// -------------------------------------------------------------------------------------------
+// Kernels specialised for each type
+// The functions above take the type as an argument; KERNELS instantiates each of them for one type, so that sizes[type]
+// and the limits of the type are constants: the loops over its bytes and nibbles have a fixed count and are unrolled,
+// and the checks on its signedness and width disappear. A field picks its kernels once, through kernels[type].
+#define KERNELS(Name, type) \
+char *EncodeBinary##Name(Value value, char *d){ return EncodeBinaryOf(value, type, d); } \
+char *EncodeBinaryBatch##Name(int count, const Value values[count], char *d){ \
+    for (int i = 0; i < count; i++) d = EncodeBinaryOf(values[i], type, d); \
+    return d; \
+} \
+char *FormatDec##Name(Value value, char *d){ return FormatDecOf(value, type, d); } \
+char *EncodeHex##Name(Value value, char *d){ return EncodeHexOf(value, type, d); } \
+char *EncodeOct##Name(Value value, char *d){ return EncodeOctOf(value, type, d); } \
+bool ParseDec##Name(const char *s, size_t len, Value *value){ return ParseDecOf(s, len, type, value); } \
+bool ParseHex##Name(const char *s, size_t len, Value *value){ return ParseHexOf(s, len, type, value); } \
+bool ParseOct##Name(const char *s, size_t len, Value *value){ return ParseOctOf(s, len, type, value); } \
+bool ParseBinary##Name(char *s[], Value *value){ return ParseBinaryOf(s, type, value); } \
+bool ParseGrouped##Name(const char *text, Value *value){ return ParseGroupedOf(text, type, value); } \
+Value LoadRaw##Name(const unsigned char *p, bool big){ return LoadRawOf(p, type, big); }
+#define KERNELTABLE(Name) {EncodeBinary##Name, EncodeBinaryBatch##Name, FormatDec##Name, EncodeHex##Name, EncodeOct##Name, \
+    ParseDec##Name, ParseHex##Name, ParseOct##Name, ParseBinary##Name, ParseGrouped##Name, LoadRaw##Name}
+
+KERNELS(Char, eCHAR)
+KERNELS(SChar, eSCHAR)
+KERNELS(UChar, eUCHAR)
+KERNELS(Short, eSHORT)
+KERNELS(UShort, eUSHORT)
+KERNELS(Int, eINT)
+KERNELS(UInt, eUINT)
+KERNELS(Long, eLONG)
+KERNELS(ULong, eULONG)
+#ifdef WIDE
+KERNELS(Int128, eINT128)
+KERNELS(UInt128, eUINT128)
+#endif
+// Position in the array corresponds to the type enums, like sizes[]
+const Kernels kernels[] = {
+    KERNELTABLE(Char), KERNELTABLE(SChar), KERNELTABLE(UChar), KERNELTABLE(Short), KERNELTABLE(UShort),
+    KERNELTABLE(Int), KERNELTABLE(UInt), KERNELTABLE(Long), KERNELTABLE(ULong),
+#ifdef WIDE
+    KERNELTABLE(Int128), KERNELTABLE(UInt128)
+#endif
+};
+
+// The functions below pick the kernel of the type on every call, for callers that convert a single value
+
+// Parses the len characters at s as a decimal value of the given type, see ParseDecOf
+bool ParseDec(const char *s, size_t len, int type, Value *value){
+    return kernels[type].parsedec(s, len, value);
+}
+
+// Writes the binary representation of value grouped in nibbles starting at d, see EncodeBinaryOf
+char *EncodeBinary(Value value, int type, char *d){
+    return kernels[type].encode(value, d);
+}
+
+// Encodes count values of the same type one after the other, e.g. all fields of a struct of ints
+char *EncodeBinaryBatch(int count, const Value values[count], int type, char *d){
+    return kernels[type].encodebatch(count, values, d);
+}
+
+// Parses the sizes[type] nibbles starting at s[0] into *value, see ParseBinaryOf
+bool ParseBinary(char *s[], int type, Value *value){
+    return kernels[type].parsebinary(s, value);
+}
+
+// Parses the sizes[type] nibbles at the start of text, each followed by one whitespace character, see ParseGroupedOf
+bool ParseGrouped(const char *text, int type, Value *value){
+    return kernels[type].parsegrouped(text, value);
+}
+
+// Returns the value of a field of the given type stored in raw bytes at p, see LoadRawOf
+Value LoadRaw(const unsigned char *p, int type, bool big){
+    return kernels[type].loadraw(p, big);
+}
+
+// Writes value, of the given type, in decimal starting at d, see FormatDecOf
+char *FormatDec(Value value, int type, char *d){
+    return kernels[type].formatdec(value, d);
+}
+
+// Writes the bit pattern of value in hex or octal starting at d, see EncodeHexOf and EncodeOctOf
+char *EncodeHex(Value value, int type, char *d){
+    return kernels[type].encodehex(value, d);
+}
+char *EncodeOct(Value value, int type, char *d){
+    return kernels[type].encodeoct(value, d);
+}
+
+// Parses the len characters at s as a value of the given type written in hex or octal, see ParseHexOf and ParseOctOf
+bool ParseHex(const char *s, size_t len, int type, Value *value){
+    return kernels[type].parsehex(s, len, value);
+}
+bool ParseOct(const char *s, size_t len, int type, Value *value){
+    return kernels[type].parseoct(s, len, value);
+}
+
+// Parses a value written in the given radix with the kernels k of its type
+// Decimal values may also be written in hex with "0x" in front, or in octal with "0o"; a bare leading '0' is not taken
+// for octal, so e.g. a nibble like "0101" given without -b stays an error instead of becoming a value
+KERNEL bool ParseText(const Kernels *k, const char *s, size_t len, int radix, Value *value){
+    if (radix == eHEX) return k->parsehex(s, len, value);
+    if (radix == eOCT) return k->parseoct(s, len, value);
+    if (len > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) return k->parsehex(s, len, value);
+    if (len > 2 && s[0] == '0' && (s[1] == 'o' || s[1] == 'O')) return k->parseoct(s, len, value);
+    return k->parsedec(s, len, value);
+}
+
+// Returns the radix given by its name, "dec", "bin", "hex" or "oct", or -1 if there is no such radix
+int RadixNamed(const char *name){
+    const char *names[] = {"dec", "bin", "hex", "oct"};
+    for (int i = eDEC; i <= eOCT; i++) if (!strcmp(name, names[i])) return i;
+    return -1;
+}
+
+// Returns the layout given by its name, "spaced", "lines", "csv", "tsv" or "fixed", or -1 if there is no such layout
+int LayoutNamed(const char *name){
+    const char *names[] = {"spaced", "lines", "csv", "tsv", "fixed"};
+    for (int i = eSPACED; i <= eFIXED; i++) if (!strcmp(name, names[i])) return i;
+    return -1;
+}
+
+// Converts string to a decimal integer
+// "valid" becomes equal to 0 if we encounter an input error
+Value ConvertDecStr(char *s, bool *valid, int type, bool testing){
+    Value value = 0;
+    *valid = ParseDec(s, strlen(s), type, &value);
+
+    // Parameter "testing" tells the function if we're testing, so it doesn't terminate the program prematurely
+    if (!(*valid) && !testing) error();
+    return value;
+}
+
+// Converts binary to decimal
+// "valid" becomes equal to 0 if a nibble isn't four binary digits
+Value ConvertBin(int n, char *s[n], int index, bool *valid, int type){
+    Value value = 0;
+    if (!ParseBinary(s + index, type, &value)) *valid = 0;
     return value;
 }
 
+// Names of the types as they are written in a struct, without spaces, e.g. "unsignedint", and the type each one stands for
+// A long is 64 bits, the same as a long long and int64_t
+const struct typename {
+    const char *name;
+    int type;
+} typenames[] = {
+    {"char", eCHAR}, {"signedchar", eSCHAR}, {"int8_t", eSCHAR}, {"unsignedchar", eUCHAR}, {"uint8_t", eUCHAR},
+    {"short", eSHORT}, {"int16_t", eSHORT}, {"unsignedshort", eUSHORT}, {"uint16_t", eUSHORT},
+    {"int", eINT}, {"int32_t", eINT}, {"unsignedint", eUINT}, {"uint32_t", eUINT},
+    {"long", eLONG}, {"longlong", eLONG}, {"int64_t", eLONG},
+    {"unsignedlong", eULONG}, {"unsignedlonglong", eULONG}, {"uint64_t", eULONG},
+#ifdef WIDE
+    {"__int128", eINT128}, {"__int128_t", eINT128}, {"unsigned__int128", eUINT128}, {"__uint128_t", eUINT128},
+#endif
+};
+
 // Checks input type
+// A type can be written in two words, "unsigned" or "signed" and the rest of it; only the first two words are needed
+// to tell which type it is, e.g. "long long" is a long and "unsigned long long" an unsigned long
 // Returns -1 if input type is invalid
 int InputType(char *s1, char *s2){
-    if (!strcmp(s1,"unsigned")){
-        if (!strcmp(s2,"char")) return eUCHAR;
-        if (!strcmp(s2,"int")) return eUINT;
-        return -1;
+    char name[32];
+    if (!strcmp(s1,"unsigned") || !strcmp(s1,"signed")){
+        if (strlen(s2) > 16) return -1; // longer than any type name
+        strcat(strcpy(name, s1), s2);
+        s1 = name;
     }
-    if (!strcmp(s1,"char")) return eCHAR;
-    if (!strcmp(s1,"int")) return eINT;
-    if (!strcmp(s1,"long")) return eLONG;
-    if (!strcmp(s1,"unsignedchar")) return eUCHAR;
-    if (!strcmp(s1,"unsignedint")) return eUINT;
+    for (size_t i = 0; i < sizeof(typenames) / sizeof(typenames[0]); i++)
+        if (!strcmp(s1, typenames[i].name)) return typenames[i].type;
     return -1;
 }
 
+// Returns the number of words a type starting with s1, s2 and s3 is written with, e.g. 2 for "unsigned int"
+// and "long long", 3 for "unsigned long long"
+int TypeWords(char *s1, char *s2, char *s3){
+    int words = 1;
+    if (!strcmp(s1,"unsigned") || !strcmp(s1,"signed")){
+        words++;
+        s1 = s2;
+        s2 = s3;
+    }
+    if (!strcmp(s1,"long") && !strcmp(s2,"long")) words++;
+    return words;
+}
+
 // Checks whether input is in binary or decimal form
 // Returns 1 if the input is binary, 0 otherwise
 bool IsBinary(int n, char *s[n]){
@@ -145,19 +946,13 @@ bool IsBinary(int n, char *s[n]){
     else{
         int x = InputType(s[1], s[2]);
         if (x == -1) return 0;
-        if (x == eUCHAR || x == eUINT) index = 3;
-        else index = 2;
+        index = 1 + TypeWords(s[1], s[2], n > 3 ? s[3] : "");
     }
     if (index >= n) return 0; // return 0 in case the index at which we start looking is out of scope
 
-    // Check if there are only 1s and 0s entered
-    for (int i = index; i < n; i++){
-        int x = strlen(s[i]);
-        if (x != 4) return 0;
-        for (int j = 0; j < x; j++){
-        if ((s[i][j] != '0') && (s[i][j] != '1')) return 0;
-        }
-    }
+    // Check if there are only nibbles of 1s and 0s entered
+    for (int i = index; i < n; i++)
+        if (ParseNibble(s[i]) < 0) return 0;
     // Check number of arguments
     // This captures the case in which for example we have to convert int 1111 from decimal to binary
     // Due to the smallest type being 2 nibbles, n must be bigger at least by 2 than index to allow checking both nibbles of a char
@@ -175,140 +970,1319 @@ bool IsBinary(int n, char *s[n]){
     return 1;
 }
 
+// Adds a field of the given type at the end of the plan, which has room for it
+void AddField(Plan *plan, int type){
+    Field *f = &plan->fields[plan->count++];
+    f->type = type;
+    f->width = sizes[type];
+    f->offset = plan->nibbles;
+    f->byteoffset = plan->bytes;
+    f->textwidth = 0;
+    f->kernels = &kernels[type];
+    plan->nibbles += sizes[type];
+    plan->bytes += sizes[type] / 2;
+}
+
+// Lays the fields out the way a C compiler lays out a struct: each field is aligned to its own size
+// and the record is padded to a multiple of the largest of them
+void AlignPlan(Plan *plan){
+    int bytes = 0, largest = 1;
+    for (int i = 0; i < plan->count; i++){
+        int size = plan->fields[i].width / 2;
+        bytes = (bytes + size - 1) / size * size;
+        plan->fields[i].byteoffset = bytes;
+        bytes += size;
+        if (size > largest) largest = size;
+    }
+    plan->bytes = (bytes + largest - 1) / largest * largest;
+}
+
+// Compiles the input types that start at s[1], e.g. "unsigned char" or "{char;int}", into a plan
+// There is no limit on how many types a structured input can have
+// Returns the index in s of the first word after the types, or -1 if they are wrong
+int CompilePlan(int n, char *s[n], Plan *plan){
+    plan->count = plan->nibbles = plan->bytes = 0;
+    plan->output = -1;
+    plan->layout = eSPACED;
+    plan->errors = NULL;
+    plan->fields = NULL;
+    if (n < 2) return -1;
+    if (s[1][0] != '{'){
+        int type = InputType(s[1], n > 2 ? s[2] : "");
+        if (type == -1) return -1;
+        plan->fields = malloc(sizeof(Field));
+        AddField(plan, type);
+        return 1 + TypeWords(s[1], n > 2 ? s[2] : "", n > 3 ? s[3] : "");
+    }
+    // The types end with the word ending in '}'; they are joined into one string "c", counting the ';' separators
+    // to know how many fields there can be
+    int last = 1, max = 1;
+    size_t length = 1;
+    while (true){
+        if (last == n) return -1;
+        size_t x = strlen(s[last]);
+        length += x;
+        for (size_t j = 0; j < x; j++) if (s[last][j] == ';') max++;
+        if (x > 0 && s[last][x-1] == '}') break;
+        last++;
+    }
+    char *c = malloc(length);
+    c[0] = '\0';
+    for (int i = 1; i <= last; i++) strcat(c, s[i]);
+
+    plan->fields = malloc(max * sizeof(Field));
+    // We will break the types string into a series of tokens, containing only the input types, one by one
+    char *token = strtok(c, "{};");
+    while (token){
+        int type = InputType(token, "");
+        if (type == -1) break;
+        AddField(plan, type);
+        token = strtok(NULL, "{};");
+    }
+    free(c);
+    if (token || plan->count == 0){
+        FreePlan(plan);
+        return -1;
+    }
+    return last + 1;
+}
+
+void FreePlan(Plan *plan){
+    free(plan->fields);
+    plan->fields = NULL;
+    plan->count = plan->nibbles = plan->bytes = 0;
+    plan->output = -1;
+    plan->layout = eSPACED;
+    plan->errors = NULL;
+}
+
 // Formats input and puts all values that need to be converted in a queue
 // Captures Input Errors regarding input type and number of types/values(or nibbles for binary input)
-void FormatInput(int n, char *s[n], bool binary, Queue *q){
-    bool structured = 0; //tells us if the input is a structured one, with multiple values, or not
-    if(s[1][0] == '{') structured = 1;
-    if (!structured){
-        int type,index;// variable index holds the index in s (main equivalent would be args) at which values that have to be converted start appearing 
-        type = InputType(s[1],s[2]); // Note that we are sure s[2] exists, since n > 2 (this function is only called in main if n > 2)
-        
-        if(type == -1) error(); //input type is wrong
-        if(type == eCHAR || type == eINT || type == eLONG) index = 2;
-        else index = 3;
-
-        if(!binary){ // "binary" tells us if the input of the program is binary or not
-            if (n != index+1) error(); //too many inputs
-            Push(q, index, type);
-        }
-        else{
-            if (n != index + sizes[type]) error(); //too many/little nibble inputs
-            Push(q, index, type);
-        }
-    }
-    if (structured){
-        // Create one string "c" that will contain all types that are in the input
-        char digits[] = "-0123456789";
-        char *c = malloc(200*sizeof(char));
-        strcpy(c,s[1]);
-
-        int i = 2;
-        while(!(strchr(digits,s[i][0])) && i < n){
-            strcat(c,s[i]);
-            i++;
-        }
-
-        int index = i, type = 0; // Save the index at which numerical values will start appearing
-        char *token;
-        // We will break the types string into a series of tokens, containing only the input types, one by one
-        token = strtok(c, "{};");
-        while(token){
-            if (index > n) error(); // Too many input types/too little values entered (index would be out of scope of args[][])
-            type = InputType(token,"");
-            if (type == -1) error(); //Input Error 
-            Push(q, index, type);
-
-            //update index for next value
-            if(!binary) index++;
-                   else index += sizes[type];
-
-            token = strtok(NULL, "{};"); //update token
-        }
-        //check that there are no values left that have no type corresponding to them i.e. too many values have been entered
-        if (index != n)  error();
-        free(c);
-        }      
-    }
-// Goes through all elements of the queue and checks if they are in between limits, catching input errors using ConvertDecStr
-// Called for decimal inputs
-void CheckLimits(int n, char *s[n], Queue *q){
-    Elem *p = q->front;
-    bool valid = 1;
-    char ANS[100];
-    while(p != NULL){
-        int index = p->index, type = p->type;
-        ConvertDec(ConvertDecStr(s[index],&valid,type,0),type,ANS);
-        p = p->next;
-    }
-}    
-
-// Empties the queue and calls the right functions for the input
-void Solve(int n, char *s[n], bool binary, Queue *q){
-    while(!QueueEmpty(q)){
-        int index = 0,type = 0;
-
-        Pop(q,&index,&type);
-        if(!binary){
-            CheckLimits(n, s, q); // Checks if each value of the queue is between its type limits
-            bool valid = 1;
-            char ANS[100];
-            ConvertDec(ConvertDecStr(s[index],&valid,type,0),type,ANS);
-            printbinary(ANS);
-        }
-        else{
-            long long value = 0;
-            value = ConvertBin(n, s, index, type);
-            printf("%lld ",value);
-        }
-    }
-    printf("\n");
+// Returns 0 for such an error
+bool FormatInput(int n, char *s[n], int radix, Queue *q){
+    bool binary = radix == eBIN;
+    Plan plan;
+    int index = CompilePlan(n, s, &plan); // index at which values that have to be converted start appearing
+    if (index == -1) return 0; // input type is wrong
+
+    // Each field takes one value, or its width in nibbles for binary input
+    int values = binary ? plan.nibbles : plan.count;
+    if (n != index + values){ // too many/little values
+        FreePlan(&plan);
+        return 0;
+    }
+    ReserveQueue(q, plan.count);
+    for (int i = 0; i < plan.count; i++)
+        Push(q, index + (binary ? plan.fields[i].offset : i), plan.fields[i].type);
+    FreePlan(&plan);
+    return 1;
+}
+
+// Empties the queue and calls the right functions for the input, appending one line to o
+// Values are read in the given radix and written in the output one, or -1 for the usual one (see Plan)
+// Returns 0 if a value is wrong, in which case nothing is added to o
+bool Solve(int n, char *s[n], int radix, int output, Queue *q, Output *o){
+    if (output < 0) output = radix == eBIN ? eDEC : eBIN;
+    size_t mark = o->len;
+    bool ok = 1;
+    if(radix != eBIN){
+        // Every value is checked and converted once before anything is printed, so a wrong value still leaves no partial output
+        // There can't be more values than arguments
+        Value *values = malloc(n * sizeof(Value));
+        int *types = malloc(n * sizeof(int));
+        int count = 0;
+        while(ok && !QueueEmpty(q)){
+            int index = 0,type = 0;
+            Pop(q,&index,&type);
+            // Values are checked as they are parsed, in the radix given or named by their prefix, see ParseText
+            ok = ParseText(&kernels[type], s[index], strlen(s[index]), radix, &values[count]);
+            types[count++] = type;
+        }
+        if (ok && output != eBIN)
+            for (int i = 0; i < count; i++) OutValue(o, &kernels[types[i]], values[i], output, sizes[types[i]]);
+        // Neighbouring values of the same type are encoded together
+        for (int i = 0; ok && output == eBIN && i < count;){
+            int j = i;
+            while (j < count && types[j] == types[i]) j++;
+            OutReserve(o, (j-i) * sizes[types[i]] * 5);
+            o->len = EncodeBinaryBatch(j-i, values+i, types[i], o->data + o->len) - o->data;
+            i = j;
+        }
+        free(values);
+        free(types);
+    }
+    else{
+        // The nibbles have only been checked by IsBinary if the input wasn't said to be binary with -i
+        while(ok && !QueueEmpty(q)){
+            int index = 0,type = 0;
+            Value value = 0;
+            Pop(q,&index,&type);
+            if ((ok = ParseBinary(s + index, type, &value))) OutValue(o, &kernels[type], value, output, sizes[type]);
+        }
+    }
+    if (!ok){
+        o->len = mark;
+        return 0;
+    }
+    OutStr(o, "\n", 1);
+    return 1;
+}
+
+// Converts the values of one invocation of visualise, args being its arguments, into a line of o
+// "-i RADIX" and "-O RADIX" in front of the data type read and write values in another radix (bin, dec, hex or oct)
+// Returns 0 for an input error, in which case nothing is added to o
+bool Request(int n, char *args[n], Output *o){
+    int radix = -1, output = -1;
+    // The options are dropped from args by moving the program name over them, so the data type stays at index 1
+    while (n > 2 && (!strcmp(args[1],"-i") || !strcmp(args[1],"-O"))){
+        if ((args[1][1] == 'i' ? (radix = RadixNamed(args[2])) : (output = RadixNamed(args[2]))) < 0) return 0;
+        args[2] = args[0];
+        args += 2;
+        n -= 2;
+    }
+    if(n <= 2) return 0; //not enough arguments
+    int b = radix >= 0 ? radix : IsBinary(n,args) ? eBIN : eDEC; //checks if input is in binary form or not
+    Queue q; //Queue which will hold data that will be manipulated
+    InitialiseQueue(&q);
+    bool ok = FormatInput(n, args, b, &q) && Solve(n, args, b, output, &q, o);
+    FreeQueue(&q);
+    return ok;
 }
 // -------------------------------------------------------------------------------------------
-// Queue Functionality
+// Statistics
+// With --stats, streaming mode tells on stderr how long each stage took and how much it did, as JSON
 
-void InitialiseQueue(Queue *q) {
-    q->front = NULL;
-    q->back = NULL;
+// Returns the time in seconds since some fixed point, from a clock that only goes forward where there is one
+double Seconds(){
+    struct timespec t;
+#ifdef POSIX
+    clock_gettime(CLOCK_MONOTONIC, &t);
+#else
+    timespec_get(&t, TIME_UTC);
+#endif
+    return t.tv_sec + t.tv_nsec * 1e-9;
 }
 
-// Adds new element to the queue
-void Push(Queue *q, int index, int type) {
-    Elem *e;
-    e = (Elem *) malloc(sizeof(Elem));
-    if (QueueEmpty(q)){//if the queue is empty both the front and the back should be the new element
-        q->back = e;
-        q->front = e;
+// Adds a block that took the given time to convert to the latency histogram
+void Latency(double seconds){
+    long long us = seconds * 1e6 + 0.5; // to the nearest microsecond, so e.g. 3e-6 isn't taken for 2.999...
+    int i = 0;
+    while (i < LATENCYBUCKETS - 1 && us >= 1LL << i) i++;
+    stats->latency[i]++;
+}
+
+// Writes the statistics of converting every record with plan on threads threads to f, as one JSON object
+// Values are counted by type from the records that were right, each holding one value of every field of the plan
+void WriteStats(FILE *f, const Plan *plan, int threads, Cache *cache){
+    double total = Seconds() - stats->start, convert = total - stats->schema - stats->read - stats->write;
+    long long right = stats->records - stats->wrong, values = right * plan->count, types[TYPECOUNT] = {0};
+    for (int i = 0; i < plan->count; i++) types[plan->fields[i].type] += right;
+    fprintf(f, "{\"threads\": %d, \"seconds\": {\"total\": %.6f, \"schema\": %.6f, \"read\": %.6f, \"convert\": %.6f, \"write\": %.6f},\n",
+            threads, total, stats->schema, stats->read, convert > 0 ? convert : 0, stats->write);
+    fprintf(f, " \"bytes\": {\"in\": %lld, \"out\": %lld}, \"records\": %lld, \"wrong\": %lld, \"values\": %lld, \"values_per_second\": %.0f,\n",
+            stats->bytesin, stats->bytesout, stats->records, stats->wrong, values, total > 0 ? values / total : 0);
+    // A type is named by the first of its names, e.g. "unsignedint" rather than "uint32_t"
+    fprintf(f, " \"types\": {");
+    const char *separator = "";
+    for (size_t i = 0; i < sizeof(typenames) / sizeof(typenames[0]); i++){
+        int type = typenames[i].type;
+        if (!types[type]) continue;
+        fprintf(f, "%s\"%s\": %lld", separator, typenames[i].name, types[type]);
+        types[type] = 0;
+        separator = ", ";
+    }
+    fprintf(f, "},\n \"errors\": {");
+    for (int i = eRANGE; i <= eSCHEMA; i++)
+        fprintf(f, "%s\"%s\": %lld", i > eRANGE ? ", " : "", errornames[i], (long long) stats->errors[i]);
+    fprintf(f, "},\n");
+    if (cache) fprintf(f, " \"cache\": {\"hits\": %lld, \"misses\": %lld},\n", cache->hits, cache->misses);
+    // Only buckets that were used are written, each with its upper bound
+    fprintf(f, " \"block_latency_us\": [");
+    separator = "";
+    for (int i = 0; i < LATENCYBUCKETS; i++){
+        if (!stats->latency[i]) continue;
+        fprintf(f, "%s{\"below\": %lld, \"count\": %lld}", separator, i < LATENCYBUCKETS - 1 ? 1LL << i : -1LL, stats->latency[i]);
+        separator = ", ";
+    }
+    fprintf(f, "]}\n");
+}
+
+// -------------------------------------------------------------------------------------------
+// Streaming mode
+// Values are read from a file (or stdin) instead of args, so one process can convert any number of records
+
+// Makes sure the output buffer can take "extra" more bytes
+void OutReserve(Output *o, size_t extra){
+    if (o->len + extra <= o->cap) return;
+    size_t cap = o->cap ? o->cap : FLUSHSIZE * 2;
+    while (cap < o->len + extra) cap *= 2;
+#ifdef POSIX
+    // Page aligned, so write(2) can hand whole pages to the kernel
+    char *data = aligned_alloc(OUTALIGN, cap);
+    if (data == NULL) error();
+    if (o->len) memcpy(data, o->data, o->len);
+    free(o->data);
+    o->data = data;
+#else
+    o->data = realloc(o->data, cap);
+    if (o->data == NULL) error();
+#endif
+    o->cap = cap;
+}
+
+// Appends len bytes of s to the output buffer
+void OutStr(Output *o, const char *s, size_t len){
+    OutReserve(o, len);
+    memcpy(o->data + o->len, s, len);
+    o->len += len;
+}
+
+// Appends a value in binary grouped in nibbles, each nibble followed by a space
+void OutBinary(Output *o, Value value, int type){
+    OutReserve(o, sizes[type] * 5);
+    o->len = EncodeBinary(value, type, o->data + o->len) - o->data;
+}
+
+// Appends a decimal value followed by a space, in the same format Solve uses
+void OutDec(Output *o, Value value, int type){
+    OutReserve(o, 42);
+    o->len = FormatDec(value, type, o->data + o->len) - o->data;
+    o->data[o->len++] = ' ';
+}
+
+// Makes an empty cache of at least the given number of slots
+Cache *NewCache(size_t slots){
+    size_t size = 1;
+    while (size < slots) size *= 2;
+    Cache *c = malloc(sizeof(Cache));
+    if (c == NULL || (c->slots = calloc(size, sizeof(Slot))) == NULL) error();
+    c->mask = size - 1;
+    c->hits = c->misses = 0;
+    return c;
+}
+
+void FreeCache(Cache *c){
+    if (c == NULL) return;
+    free(c->slots);
+    free(c);
+}
+
+// Writes value in hex, octal or decimal followed by a space starting at d, copying it from the cache c if it is there
+// and putting it there otherwise; d needs room for CACHETEXT bytes
+// Returns a pointer to the end of the text
+KERNEL char *CachedValue(Cache *c, const Kernels *k, int type, Value value, int radix, char *d){
+    UValue bits = value;
+    unsigned long long h = (unsigned long long) bits;
+#ifdef WIDE
+    h ^= (unsigned long long) (bits >> 64) * 31;
+#endif
+    h = (h ^ (unsigned) (type << 2 | radix)) * 0x9E3779B97F4A7C15ULL;
+    size_t home = (h ^ h >> 32) & c->mask;
+    Slot *target = &c->slots[home];
+    for (size_t i = 0; i < CACHEPROBES; i++){
+        Slot *slot = &c->slots[(home + i) & c->mask];
+        if (slot->len == 0){
+            target = slot;
+            break;
+        }
+        if (slot->value == value && slot->type == type && slot->radix == radix){
+            c->hits++;
+            memcpy(d, slot->text, CACHETEXT);
+            return d + slot->len;
+        }
+    }
+    c->misses++;
+    char *end = radix == eHEX ? k->encodehex(value, d) : radix == eOCT ? k->encodeoct(value, d) : k->formatdec(value, d);
+    *end++ = ' ';
+    target->value = value;
+    target->type = type;
+    target->radix = radix;
+    target->len = end - d;
+    memcpy(target->text, d, target->len);
+    return end;
+}
+
+// Appends a value written in the given radix, with the kernels k of its type and its width in nibbles, followed by a space
+void OutValue(Output *o, const Kernels *k, Value value, int radix, int width){
+    OutReserve(o, width * 5 + 46);
+    char *d = o->data + o->len;
+    // Binary and 8 bit values are written from tables already, which is quicker than looking them up
+    if (o->cache && radix != eBIN && width > 2){
+        o->len = CachedValue(o->cache, k, k - kernels, value, radix, d) - o->data;
+        return;
     }
-    else{ //add the new element at the back of the queue
-    q->back->next = e;
-    e->next = NULL;
-    q->back = e;
+    switch (radix){
+        case eBIN: o->len = k->encode(value, d) - o->data; return; // already ends with a space
+        case eHEX: d = k->encodehex(value, d); break;
+        case eOCT: d = k->encodeoct(value, d); break;
+        default: d = k->formatdec(value, d);
     }
+    *d++ = ' ';
+    o->len = d - o->data;
+}
+
+// Stops the program when its output can't be written, e.g. because the disk is full or nobody reads the pipe any more
+// Unlike error it tells why on stderr, since stdout is what failed
+void OutputFailed(const char *why){
+    fprintf(stderr, "Output error: %s.\n", why);
+    exit(1);
+}
 
-    e->next = NULL;
-    e->type = type;
-    e->index = index;
+// Opens the file named path for writing, in place of stdout if to is stdout, as -o and -K do once the input in is open
+// A file that is the input is refused, since opening it would truncate it before it is read
+FILE *OpenOutput(const char *path, FILE *to, FILE *in){
+#ifdef POSIX
+    struct stat st, input;
+    if (!stat(path, &st) && S_ISREG(st.st_mode) && !fstat(fileno(in), &input) && st.st_dev == input.st_dev
+        && st.st_ino == input.st_ino) OutputFailed("the output file is the input file");
+#endif
+    FILE *f = to ? freopen(path, "wb", to) : fopen(path, "w");
+#ifdef POSIX
+    if (f == NULL) OutputFailed(strerror(errno));
+#endif
+    if (f == NULL) OutputFailed("can't open the output file");
+    return f;
+}
 
+// Writes the output buffer with write(2) where available, skipping the copy into stdio's buffer
+void FlushOutput(Output *o){
+    if (!o->len) return;
+    double start = stats ? Seconds() : 0;
+#ifdef POSIX
+    if (fflush(stdout)) OutputFailed(strerror(errno)); // anything printed before goes first
+    size_t done = 0;
+    while (done < o->len){
+        ssize_t w = write(STDOUT_FILENO, o->data + done, o->len - done);
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0) OutputFailed(strerror(errno));
+        done += w;
+    }
+#else
+    if (fwrite(o->data, 1, o->len, stdout) != o->len) OutputFailed("write failed");
+#endif
+    if (stats){
+        stats->write += Seconds() - start;
+        stats->bytesout += o->len;
+    }
+    o->len = 0;
+}
+
+// Writes a block of output converted by this thread, adding how long converting it took to the latency histogram
+void FlushBlock(Output *o){
+    if (stats && o->len) Latency(Seconds() - stats->lap);
+    FlushOutput(o);
+    if (stats) stats->lap = Seconds();
+}
+
+// Returns 1 for the characters that separate values in streaming mode
+bool IsSpace(char c){
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+// Moves the unread part of the buffer to the front and reads the next block of the input after it
+void Refill(Reader *r){
+    size_t keep = r->len - r->pos;
+    if (keep == r->size){ // a single token fills the whole block, so it grows to make room for the rest
+        r->block = realloc(r->block, r->size * 2);
+        if (r->block == NULL) error();
+        r->buf = r->block;
+        r->size *= 2;
+    }
+    memmove(r->block, r->buf + r->pos, keep);
+    r->buf = r->block;
+    r->pos = 0;
+    double start = stats ? Seconds() : 0;
+    size_t got = fread(r->block + keep, 1, r->size - keep, r->f);
+    if (stats){
+        stats->read += Seconds() - start;
+        stats->bytesin += got;
+    }
+    r->len = keep + got;
+    if (got < r->size - keep) r->eof = 1;
 }
 
-// Saves type and index of the front of the queue then deletes the first element of the queue
+// Skips whitespace and makes sure at least "need" bytes of the input are in the buffer, unless the input ends first
+// Returns the number of bytes available from r->pos, which is 0 once the input is exhausted
+size_t Fill(Reader *r, size_t need){
+    while (true){
+        while (r->pos < r->len && IsSpace(r->buf[r->pos])) r->pos++;
+        if (r->len - r->pos >= need || r->eof) return r->len - r->pos;
+        Refill(r);
+    }
+}
+
+// Puts a view of the next whitespace separated token of the input in *tok
+// The token stays valid until the next call; returns 0 once the input is exhausted
+bool NextToken(Reader *r, View *tok){
+    while (true){
+        while (r->pos < r->len && IsSpace(r->buf[r->pos])) r->pos++;
+        size_t end = r->pos;
+        while (end < r->len && !IsSpace(r->buf[end])) end++;
+        if (end < r->len || (r->eof && end > r->pos)){
+            tok->s = r->buf + r->pos;
+            tok->len = end - r->pos;
+            r->pos = end;
+            return 1;
+        }
+        if (r->eof) return 0;
+        Refill(r); // the token might continue in the next block
+    }
+}
+
+// Tells why a token that should be a value in the given radix isn't one: eDIGIT if it has a character
+// that can't be in such a value, eRANGE if it only has the wrong number of digits or is too big for its type
+int ValueError(const char *s, size_t len, int radix){
+    size_t i = 0;
+    bool prefix = len > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X' || s[1] == 'o' || s[1] == 'O');
+    if (radix == eDEC && prefix) radix = s[1] == 'x' || s[1] == 'X' ? eHEX : eOCT; // as ParseText reads it
+    if (radix == eDEC && len > 0 && s[0] == '-') i = 1;
+    else if (radix != eDEC && prefix) i = 2;
+    if (i == len || (radix == eDEC && len - i > 1 && s[i] == '0')) return eDIGIT; // no digits, or a leading zero
+    for (; i < len; i++)
+        if (radix == eHEX ? hexvalue[(unsigned char) s[i]] < 0 : s[i] < '0' || s[i] > (radix == eOCT ? '7' : '9')) return eDIGIT;
+    return eRANGE;
+}
+
+// Records what is wrong with the current record of r and in which field, and skips the "skip" tokens left in it,
+// so the next record starts where it should
+// Returns 0, for ConvertRecord to return
+bool Reject(Reader *r, int code, int field, long skip){
+    View tok;
+    r->code = code;
+    r->field = field + 1;
+    while (skip-- > 0 && NextToken(r, &tok));
+    return 0;
+}
+
+// Reads the nibbles of field i of the plan from r into *value
+// Returns 0 if they are wrong or the input ends first, see Reject
+KERNEL bool ReadNibbles(Reader *r, const Plan *plan, int i, Value *value){
+    const Field *field = &plan->fields[i];
+    // Nibbles written one after the other with single spaces are parsed straight from the buffer
+    size_t length = field->width * 5;
+    if (Fill(r, length) >= length && field->kernels->parsegrouped(r->buf + r->pos, value)){
+        r->pos += length;
+        return 1;
+    }
+    // Otherwise each nibble is checked and added as soon as it's read, since the reader may reuse its buffer for the next one
+    View tok;
+    UValue bits = 0;
+    for (int j = 0; j < field->width; j++){
+        long left = plan->nibbles - field->offset - j - 1; // tokens after this one
+        if (!NextToken(r, &tok)) return Reject(r, eNIBBLES, i, 0);
+        if (tok.len != 4) return Reject(r, eNIBBLES, i, left);
+        int nibble = PackNibble(tok.s);
+        if (nibble < 0) return Reject(r, eDIGIT, i, left);
+        bits = bits << 4 | nibble;
+    }
+    *value = SignExtend(bits, field->type);
+    return 1;
+}
+
+// Sets how the values of plan, written in the given radix, are laid out
+// Fixed width records are as long as one another, so record k starts k times that length into the output; each value
+// is right aligned in as many characters as the longer of the limits of its type takes, which is all of them except in decimal
+void LayoutPlan(Plan *plan, int layout, int radix){
+    plan->layout = layout;
+    char text[200];
+    for (int i = 0; i < plan->count; i++){
+        Field *f = &plan->fields[i];
+        const Kernels *k = f->kernels;
+        f->textwidth = 0;
+        for (int j = 0; j < 2; j++){
+            Value limit = j ? (Value) upperlimit[f->type] : lowerlimit[f->type];
+            char *end = radix == eBIN ? k->encode(limit, text) - 1 : radix == eHEX ? k->encodehex(limit, text) :
+                        radix == eOCT ? k->encodeoct(limit, text) : k->formatdec(limit, text);
+            if (end - text > f->textwidth) f->textwidth = end - text;
+        }
+    }
+}
+
+// Lays out the value of field i just written to o from mark on, which is followed by a space, the way plan->layout says
+// The space becomes what separates the value from the next one, or a newline after the last value of a record
+KERNEL void LayValue(Output *o, const Plan *plan, int i, size_t mark){
+    bool last = i == plan->count - 1;
+    switch (plan->layout){
+        case eLINES: o->data[o->len - 1] = '\n'; return;
+        case eCSV: o->data[o->len - 1] = last ? '\n' : ','; return;
+        case eTSV: o->data[o->len - 1] = last ? '\n' : '\t'; return;
+    }
+    size_t len = o->len - 1 - mark, width = plan->fields[i].textwidth;
+    if (len < width){
+        OutReserve(o, width - len);
+        memmove(o->data + mark + width - len, o->data + mark, len);
+        memset(o->data + mark, ' ', width - len);
+        o->len = mark + width + 1;
+    }
+    o->data[o->len - 1] = last ? '\n' : ' ';
+}
+
+// Converts the next record of r into o, one line of output
+// A record holds one value per field of the plan, each being one token in the given radix, or its width in nibbles if binary
+// Values are written in plan->output and laid out as plan->layout says, see Plan
+// Returns 0 if the record is wrong or incomplete, in which case part of it may already be in o, see Reject
+bool ConvertRecord(Reader *r, Plan *plan, int radix, Output *o){
+    View tok;
+    int output = plan->output >= 0 ? plan->output : radix == eBIN ? eDEC : eBIN;
+    for (int i = 0; i < plan->count; i++){
+        const Kernels *k = plan->fields[i].kernels;
+        size_t mark = o->len;
+        Value value = 0;
+        if (radix != eBIN){
+            if (!NextToken(r, &tok)) return Reject(r, eSCHEMA, i, 0); // too few values in the last record
+            if (!ParseText(k, tok.s, tok.len, radix, &value))
+                return Reject(r, ValueError(tok.s, tok.len, radix), i, plan->count - i - 1);
+        }
+        else if (!ReadNibbles(r, plan, i, &value)) return 0;
+        if (output == eBIN){
+            OutReserve(o, plan->fields[i].width * 5);
+            o->len = k->encode(value, o->data + o->len) - o->data;
+        }
+        else OutValue(o, k, value, output, plan->fields[i].width);
+        if (plan->layout != eSPACED) LayValue(o, plan, i, mark);
+    }
+    if (plan->layout == eSPACED) OutStr(o, "\n", 1);
+    return 1;
+}
+
+// Appends a line telling which record is wrong and why, e.g. "Input error in record 3, field 2: bad digit."
+void DescribeError(Output *o, Fault fault){
+    char line[128];
+    int len = fault.field ? sprintf(line, "Input error in record %ld, field %d: %s.\n", fault.record, fault.field, errornames[fault.code])
+                          : sprintf(line, "Input error in record %ld: %s.\n", fault.record, errornames[fault.code]);
+    OutStr(o, line, len);
+}
+
+// Writes the descriptions of wrong records in o to f
+void WriteErrors(Output *o, FILE *f){
+    if (o->len) fwrite(o->data, 1, o->len, f);
+    o->len = 0;
+}
+
+// Tells on stderr which record is wrong and stops with an input error
+void StopAt(Fault fault){
+    Output o = {NULL, 0, 0, NULL};
+    DescribeError(&o, fault);
+    WriteErrors(&o, stderr);
+    free(o.data);
+    error();
+}
+
+// Converts records of r into o until the input ends, writing o to stdout whenever it fills up if flush is set
+// Nothing of a wrong record is left in o; if errors is NULL it ends the conversion, otherwise it is described in errors,
+// which may be o itself, and the conversion goes on with the next record
+// Returns the number of wrong records
+long ConvertRecords(Reader *r, Plan *plan, int radix, Output *o, Output *errors, bool flush){
+    long wrong = 0;
+    while (Fill(r, 1)){
+        size_t mark = o->len; // where this record starts
+        r->record++;
+        if (!ConvertRecord(r, plan, radix, o)){
+            o->len = mark;
+            wrong++;
+            if (stats) atomic_fetch_add(&stats->errors[r->code], 1);
+            if (errors == NULL) break;
+            DescribeError(errors, (Fault) {r->record, r->field, r->code});
+        }
+        if (flush && o->len >= FLUSHSIZE) FlushBlock(o);
+    }
+    return wrong;
+}
+
+// Converts every record in f, one record per output line
+// The first wrong record stops everything with an input error, unless plan->errors says where to describe wrong records
+// If f was memory mapped, map holds all of its size bytes and is parsed in place
+// Returns the number of wrong records
+long Stream(FILE *f, const char *map, size_t size, Plan *plan, int radix){
+    Reader r = {f, NULL, map, 0, size, size, 1};
+    if (map == NULL){
+        r.block = malloc(READSIZE);
+        r.buf = r.block;
+        r.len = 0;
+        r.size = READSIZE;
+        r.eof = 0;
+    }
+    Output side = {NULL, 0, 0, NULL};
+    Output *errors = plan->errors == NULL ? NULL : plan->errors == stdout ? &out : &side;
+    long wrong = ConvertRecords(&r, plan, radix, &out, errors, 1);
+    if (stats) stats->records = r.record;
+    free(r.block);
+    if (wrong && errors == NULL) StopAt((Fault) {r.record, r.field, r.code});
+    WriteErrors(&side, plan->errors);
+    free(side.data);
+    return wrong;
+}
+
+// Maps the whole of f into memory, so its records are parsed where they are instead of being copied
+// Returns NULL if f can't be mapped, e.g. if it is a pipe or empty, in which case it is read in blocks instead
+const char *MapFile(FILE *f, size_t *size){
+#ifdef POSIX
+    struct stat st;
+    if (fstat(fileno(f), &st) || !S_ISREG(st.st_mode) || st.st_size == 0) return NULL;
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (map == MAP_FAILED) return NULL;
+    posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+    *size = st.st_size;
+    return map;
+#else
+    return NULL;
+#endif
+}
+
+void UnmapFile(const char *map, size_t size){
+#ifdef POSIX
+    if (map) munmap((void *) map, size);
+#endif
+}
+
+// Makes sure the buffer of the chunk can hold size bytes
+void ChunkReserve(Chunk *c, size_t size){
+    if (size <= c->size && c->buf) return;
+    c->buf = realloc(c->buf, size);
+    if (c->buf == NULL) error();
+    c->size = size;
+}
+
+// Returns the position right after the last whole record at the start of data, or 0 if there is none,
+// and puts the number of whole records in *records
+// tokens is the number of tokens in a record; a token touching the end of data might continue after it, so isn't counted
+size_t RecordBoundary(const char *data, size_t len, long tokens, long *records){
+    size_t end = 0, i = 0;
+    long count = 0;
+    *records = 0;
+    while (i < len){
+        while (i < len && IsSpace(data[i])) i++;
+        while (i < len && !IsSpace(data[i])) i++;
+        if (i == len) break;
+        count++;
+        if (count == tokens){
+            end = i;
+            count = 0;
+            ++*records;
+        }
+    }
+    return end;
+}
+
+// Fills c with the next whole records of f, starting with what was left over from the previous chunk in carry
+// Whatever follows the last whole record goes back to carry; at the end of f everything left is put in c
+// Returns 0 once f is exhausted
+bool ReadChunk(FILE *f, Chunk *c, Chunk *carry, long tokens){
+    ChunkReserve(c, carry->len + CHUNKSIZE);
+    memcpy(c->buf, carry->buf, carry->len);
+    c->data = c->buf;
+    c->len = carry->len;
+    while (true){
+        size_t want = c->size - c->len;
+        size_t got = fread(c->buf + c->len, 1, want, f);
+        c->len += got;
+        bool eof = got < want;
+        c->records = 0;
+        size_t end = eof ? c->len : RecordBoundary(c->buf, c->len, tokens, &c->records);
+        if (end > 0 || eof){
+            ChunkReserve(carry, c->len - end);
+            memcpy(carry->buf, c->buf + end, c->len - end);
+            carry->data = carry->buf;
+            carry->len = c->len - end;
+            c->len = end;
+            return end > 0;
+        }
+        ChunkReserve(c, c->size * 2); // not even one whole record fits
+        c->data = c->buf;
+    }
+}
+
+// Points c at the next whole records of the memory mapped input, from *pos onwards, without copying them
+// Returns 0 at the end of the input
+bool MapChunk(const char *map, size_t size, size_t *pos, Chunk *c, long tokens){
+    if (*pos >= size) return 0;
+    size_t window = CHUNKSIZE, end = 0;
+    c->records = 0;
+    while (end == 0){
+        if (size - *pos <= window) end = size - *pos; // the rest of the input
+        else end = RecordBoundary(map + *pos, window, tokens, &c->records);
+        window *= 2; // not even one whole record fits
+    }
+    c->data = map + *pos;
+    c->len = end;
+    *pos += end;
+    return 1;
+}
+
+// Converts the records of a chunk into its own output buffer, and describes wrong records as plan->errors says
+void ConvertChunk(Chunk *c, Plan *plan, int radix){
+    double start = stats ? Seconds() : 0;
+    Reader r = {NULL, NULL, c->data, 0, c->len, c->len, 1, c->first};
+    c->out.len = c->errors.len = 0;
+    Output *errors = plan->errors == NULL ? NULL : plan->errors == stdout ? &c->out : &c->errors;
+    c->wrong = ConvertRecords(&r, plan, radix, &c->out, errors, 0);
+    c->ok = c->wrong == 0;
+    c->fault = (Fault) {r.record, r.field, r.code};
+    if (stats) c->seconds = Seconds() - start;
+}
+
+#ifndef _WIN32
+// Run by every thread of the pool: converts the queued chunks in turn, waiting for more, until told to stop
+void *Worker(void *arg){
+    Pool *p = arg;
+    pthread_mutex_lock(&p->lock);
+    Cache *cache = p->caches ? p->caches[p->workers++] : NULL;
+    while (true){
+        while (p->next == p->queued && !p->stop) pthread_cond_wait(&p->work, &p->lock);
+        if (p->stop) break;
+        int slot = p->next++ % p->count;
+        pthread_mutex_unlock(&p->lock);
+        p->chunks[slot].out.cache = cache;
+        ConvertChunk(&p->chunks[slot], p->plan, p->radix);
+        pthread_mutex_lock(&p->lock);
+        p->done[slot] = 1;
+        pthread_cond_signal(&p->finished);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+// Tells the started workers of the pool to finish and waits for them
+void StopWorkers(Pool *p, pthread_t *ids, int started){
+    pthread_mutex_lock(&p->lock);
+    p->stop = 1;
+    pthread_cond_broadcast(&p->work);
+    pthread_mutex_unlock(&p->lock);
+    for (int i = 0; i < started; i++) pthread_join(ids[i], NULL);
+}
+
+// Converts every record in f with a pool of threads; the output is the same as Stream's, in the same order
+// The workers are started once; meanwhile this thread reads the next chunks into the free slots of the pool and
+// writes the converted ones in input order
+// If f was memory mapped, map holds all of its size bytes and chunks point straight into it
+// Returns the number of wrong records
+long StreamParallel(FILE *f, const char *map, size_t size, Plan *plan, int radix, int threads){
+    int count = threads * 2; // chunks in flight, so a worker that finishes early finds another one waiting
+    Pool p = {calloc(count, sizeof(Chunk)), calloc(count, sizeof(bool)), count, plan, radix};
+    if (p.chunks == NULL || p.done == NULL) error();
+    Chunk carry = {NULL, 0, NULL, 0, {NULL, 0, 0, NULL}, 1};
+    ChunkReserve(&carry, CHUNKSIZE);
+    long tokens = radix == eBIN ? plan->nibbles : plan->count;
+    // Threads can't share a cache, so each gets one as big as that of the output, which is the first thread's;
+    // RunStream splits the slots of -m between them
+    if (out.cache){
+        p.caches = malloc(threads * sizeof(Cache *));
+        if (p.caches == NULL) error();
+        p.caches[0] = out.cache;
+        for (int i = 1; i < threads; i++) p.caches[i] = NewCache(out.cache->mask + 1);
+    }
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.work, NULL);
+    pthread_cond_init(&p.finished, NULL);
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    while (ids && started < threads && !pthread_create(&ids[started], NULL, Worker, &p)) started++;
+    size_t pos = 0;
+    long records = 0, wrong = 0, written = 0;
+    bool more = 1;
+    while (true){
+        // Chunks are read while the workers convert the ones before them, up to one per slot
+        while (more && p.queued - written < count){
+            Chunk *c = &p.chunks[p.queued % count];
+            double start = stats ? Seconds() : 0;
+            more = map ? MapChunk(map, size, &pos, c, tokens) : ReadChunk(f, c, &carry, tokens);
+            if (stats) stats->read += Seconds() - start;
+            if (!more) break;
+            c->first = records;
+            records += c->records;
+            pthread_mutex_lock(&p.lock);
+            p.queued++;
+            pthread_cond_signal(&p.work);
+            pthread_mutex_unlock(&p.lock);
+        }
+        if (written == p.queued) break;
+        // Chunks are written in input order; a wrong record stops everything after it, as in Stream
+        int slot = written++ % count;
+        Chunk *c = &p.chunks[slot];
+        pthread_mutex_lock(&p.lock);
+        if (!started){ // no worker could be started, so this thread converts the chunks itself
+            p.next++;
+            c->out.cache = out.cache;
+            ConvertChunk(c, plan, radix);
+            p.done[slot] = 1;
+        }
+        while (!p.done[slot]) pthread_cond_wait(&p.finished, &p.lock);
+        p.done[slot] = 0;
+        pthread_mutex_unlock(&p.lock);
+        FlushOutput(&c->out);
+        if (!c->ok && plan->errors == NULL){
+            StopWorkers(&p, ids, started);
+            StopAt(c->fault);
+        }
+        WriteErrors(&c->errors, plan->errors);
+        wrong += c->wrong;
+        if (stats){
+            Latency(c->seconds);
+            stats->bytesin += c->len;
+            stats->records = c->fault.record; // all records up to the end of the chunk
+        }
+    }
+    StopWorkers(&p, ids, started);
+    free(ids);
+    pthread_mutex_destroy(&p.lock);
+    pthread_cond_destroy(&p.work);
+    pthread_cond_destroy(&p.finished);
+    for (int i = 1; p.caches && i < threads; i++){
+        out.cache->hits += p.caches[i]->hits;
+        out.cache->misses += p.caches[i]->misses;
+        FreeCache(p.caches[i]);
+    }
+    free(p.caches);
+    for (int i = 0; i < count; i++){
+        free(p.chunks[i].buf);
+        free(p.chunks[i].out.data);
+        free(p.chunks[i].errors.data);
+    }
+    free(p.chunks);
+    free(p.done);
+    free(carry.buf);
+    return wrong;
+}
+#endif
+
+// Decodes count raw records of plan->bytes bytes each into o, printing the fields in the output radix
+void DecodeRaw(const unsigned char *data, size_t count, Plan *plan, bool big, int output, Output *o){
+    for (size_t r = 0; r < count; r++, data += plan->bytes){
+        for (int i = 0; i < plan->count; i++){
+            const Kernels *k = plan->fields[i].kernels;
+            Value value = k->loadraw(data + plan->fields[i].byteoffset, big);
+            size_t mark = o->len;
+            OutValue(o, k, value, output, plan->fields[i].width);
+            if (plan->layout != eSPACED) LayValue(o, plan, i, mark);
+        }
+        if (plan->layout == eSPACED) OutStr(o, "\n", 1);
+        if (o->len >= FLUSHSIZE) FlushBlock(o);
+    }
+}
+
+// Decodes every raw record in f, e.g. a memory image of an array of C structs, one record per output line
+// If f was memory mapped, map holds all of its size bytes and is decoded in place
+// If the input ends in the middle of a record, that record is wrong; it stops with an input error unless plan->errors
+// says where to describe it
+// Returns the number of wrong records
+long StreamRaw(FILE *f, const char *map, size_t size, Plan *plan, bool big, int output){
+    size_t bytes = plan->bytes, left = 0;
+    long records = 0;
+    if (map){
+        DecodeRaw((const unsigned char *) map, size / bytes, plan, big, output, &out);
+        records = size / bytes;
+        left = size % bytes;
+    }
+    else{
+        // Blocks hold a whole number of records
+        size_t block = READSIZE / bytes > 0 ? READSIZE / bytes * bytes : bytes;
+        unsigned char *buf = malloc(block);
+        size_t got;
+        double start = stats ? Seconds() : 0;
+        while ((got = fread(buf, 1, block, f)) > 0){
+            if (stats){
+                stats->read += Seconds() - start;
+                stats->bytesin += got;
+            }
+            DecodeRaw(buf, got / bytes, plan, big, output, &out);
+            records += got / bytes;
+            left = got % bytes;
+            if (got < block) break;
+            if (stats) start = Seconds();
+        }
+        free(buf);
+    }
+    if (stats){
+        stats->records = records + (left > 0);
+        if (left) stats->errors[eSCHEMA]++;
+    }
+    if (!left) return 0;
+    Fault fault = {records + 1, 0, eSCHEMA};
+    if (plan->errors == NULL) StopAt(fault);
+    Output side = {NULL, 0, 0, NULL};
+    DescribeError(plan->errors == stdout ? &out : &side, fault);
+    WriteErrors(&side, plan->errors);
+    free(side.data);
+    return 1;
+}
+
+// Returns the whole number from 1 to max written in text and nothing else, e.g. the thread count of -j, or 0 if there is none
+long Count(const char *text, long max){
+    char *end;
+    if (text[0] < '0' || text[0] > '9') return 0; // strtol would skip spaces and take a sign
+    long count = strtol(text, &end, 10);
+    return *end == '\0' && count <= max ? count : 0;
+}
+
+// Handles "visualise -f FILE [-b] [-i RADIX] [-O RADIX] [-l LAYOUT] [-j N] [-m SLOTS] [-k|-K ERRORS] [-o OUTPUT] [--stats] [DataType]"
+// and "visualise -r FILE [-e big|little] [-a] [-B] [-O RADIX] [-l LAYOUT] [-m SLOTS] [-k|-K ERRORS] [-o OUTPUT] [--stats] [DataType]"
+// FILE is "-" for stdin, -b marks binary input, -i reads values in another radix (bin, dec, hex or oct),
+// -O writes them in one, -l lays them out as spaced, lines, csv, tsv or fixed (see LayoutPlan), -j sets the number of
+// threads converting records, up to MAXTHREADS, and -o writes the output to a file other than the input instead of stdout
+// -m keeps the text of values written before in a cache of the given number of slots, up to MAXSLOTS, split between the threads,
+// and prints how often it had them
+// -k (or --keep-going) describes wrong records in the output in their place and goes on, -K does so in the file ERRORS
+// ("-" for stderr) instead; either way the exit status is 1 if there were any
+// --stats writes how long each stage took and how much it did to stderr when done, see WriteStats
+// With -r the input holds raw records in the given byte order (little endian by default), laid out like a C struct
+// with -a or packed otherwise, and -B prints them in binary instead of decimal
+void RunStream(int n, char *s[n]){
+    if (n < 4) error();
+    int k = 3, threads = 1, radix = eDEC, output = -1, layout = eSPACED;
+    long slots = 0;
+    FILE *errors = NULL;
+    const char *outfile = NULL, *errorfile = NULL;
+    Stats counters = {0};
+    bool raw = !strcmp(s[1],"-r"), big = 0, aligned = 0;
+    while (k < n && s[k][0] == '-'){
+        if (!strcmp(s[k],"-b") && !raw) radix = eBIN;
+        else if (!strcmp(s[k],"-i") && !raw && k+1 < n && (radix = RadixNamed(s[k+1])) >= 0) k++;
+        else if (!strcmp(s[k],"-O") && k+1 < n && (output = RadixNamed(s[k+1])) >= 0) k++;
+        else if (!strcmp(s[k],"-l") && k+1 < n && (layout = LayoutNamed(s[k+1])) >= 0) k++;
+        else if (!strcmp(s[k],"-j") && !raw && k+1 < n && (threads = Count(s[k+1], MAXTHREADS)) > 0) k++;
+        else if (!strcmp(s[k],"-m") && k+1 < n && (slots = Count(s[k+1], MAXSLOTS)) > 0) k++;
+        else if (!strcmp(s[k],"-k") || !strcmp(s[k],"--keep-going")) errors = stdout, errorfile = NULL;
+        else if (!strcmp(s[k],"-K") && k+1 < n) errorfile = s[++k];
+        else if (!strcmp(s[k],"-o") && k+1 < n) outfile = s[++k];
+        else if (!strcmp(s[k],"-e") && raw && k+1 < n && (!strcmp(s[k+1],"big") || !strcmp(s[k+1],"little"))){
+            big = !strcmp(s[k+1],"big");
+            k++;
+        }
+        else if (!strcmp(s[k],"-a") && raw) aligned = 1;
+        else if (!strcmp(s[k],"-B") && raw) output = eBIN;
+        else if (!strcmp(s[k],"--stats")) stats = &counters;
+        else error();
+        k++;
+    }
+    // Passing s+k-1 makes the first type word appear at index 1, where CompilePlan expects it
+    // The plan is compiled once for the whole input
+    if (stats) counters.start = Seconds();
+    Plan plan;
+    if (CompilePlan(n-k+1, s+k-1, &plan) != n-k+1) error();
+    if (aligned) AlignPlan(&plan);
+    if (stats) counters.schema = Seconds() - counters.start;
+    plan.output = output;
+    LayoutPlan(&plan, layout, output >= 0 ? output : raw || radix == eBIN ? eDEC : eBIN);
+
+    FILE *f = stdin;
+    if (strcmp(s[2],"-")) f = fopen(s[2], "rb");
+    if (f == NULL) error();
+    size_t size = 0;
+    double start = stats ? Seconds() : 0;
+    const char *map = MapFile(f, &size);
+    if (stats){
+        counters.read += Seconds() - start;
+        counters.lap = Seconds();
+    }
+    // The output files are only opened now, so they can be checked against the input before they truncate it
+    if (outfile) OpenOutput(outfile, stdout, f);
+    if (errorfile) errors = strcmp(errorfile,"-") ? OpenOutput(errorfile, NULL, f) : stderr;
+    plan.errors = errors;
+#ifdef _WIN32
+    threads = 1; // no threads on native Windows
+#endif
+    // With threads the slots are split between their caches, see StreamParallel
+    if (slots) out.cache = NewCache(threads > 1 ? (slots + threads - 1) / threads : slots);
+    long wrong;
+    if (raw) wrong = StreamRaw(f, map, size, &plan, big, output < 0 ? eDEC : output);
+#ifndef _WIN32
+    else if (threads > 1) wrong = StreamParallel(f, map, size, &plan, radix, threads);
+#endif
+    else wrong = Stream(f, map, size, &plan, radix);
+    FlushBlock(&out);
+    if (stats){
+        if (map) counters.bytesin = size;
+        counters.wrong = wrong;
+        WriteStats(stderr, &plan, threads, out.cache);
+        stats = NULL;
+    }
+    if (out.cache){
+        fprintf(stderr, "Cache: %lld hits, %lld misses\n", out.cache->hits, out.cache->misses);
+        FreeCache(out.cache);
+        out.cache = NULL;
+    }
+    UnmapFile(map, size);
+    if (f != stdin) fclose(f);
+    if (errors && errors != stdout && errors != stderr) fclose(errors);
+    FreePlan(&plan);
+    if (wrong) exit(1);
+}
+// -------------------------------------------------------------------------------------------
+// Server mode
+// A long running server answers requests from clients over a Unix domain socket, so a client doesn't start a process
+// for every conversion; a request is a line holding what would follow "visualise" on the command line, e.g. "int 5"
+// or "-O hex {char;int} 7 5", and its answer is the line visualise would print, "Input error." included
+// Clients can send any number of requests without waiting for the answers, which come back in the same order
+
+#define MAXREQUEST (1 << 20) // the longest request line
+#define MAXEVENTS 64
+
+// Answers one request line, which is split into words in place, appending the answer to o
+void Answer(char *line, Output *o){
+    // A line of length l has at most l/2+1 words, and the program name comes before them
+    char **args = malloc((strlen(line) / 2 + 2) * sizeof(char *));
+    if (args == NULL) error();
+    int n = 0;
+    args[n++] = "visualise";
+    for (char *word = line; *word;){
+        while (IsSpace(*word)) *word++ = '\0';
+        if (*word == '\0') break;
+        args[n++] = word;
+        while (*word && !IsSpace(*word)) word++;
+    }
+    if (!Request(n, args, o)) OutStr(o, "Input error.\n", 13);
+    free(args);
+}
+
+// Answers every whole request line at the start of the len bytes of buf, appending the answers to o
+// Returns the number of bytes answered; whatever follows the last newline is a request that hasn't fully arrived yet
+size_t AnswerLines(char *buf, size_t len, Output *o){
+    size_t start = 0;
+    char *end;
+    while ((end = memchr(buf + start, '\n', len - start)) != NULL){
+        *end = '\0';
+        Answer(buf + start, o);
+        start = end - buf + 1;
+    }
+    return start;
+}
+
+#ifdef __linux__
+// A client of the server: its socket, the part of a request that has arrived so far in buf, and the answers in out,
+// of which "sent" bytes have been sent; done is set once the client has stopped sending, or the connection failed
+// events are the epoll events the server waits for on its socket
+struct connection {
+    int fd;
+    char *buf;
+    size_t len, size, sent;
+    Output out;
+    bool done;
+    unsigned events;
+};
+typedef struct connection Connection;
+
+// Makes a socket non-blocking, so the server never waits on one client while others are ready
+void NonBlocking(int fd){
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// Reads what the client has sent, up to about MAXREQUEST bytes at a time, and answers all whole requests in it
+void ReadRequests(Connection *c){
+    while (!c->done && c->len < MAXREQUEST){
+        if (c->size - c->len < 4096){
+            c->size = c->size ? c->size * 2 : 8192;
+            c->buf = realloc(c->buf, c->size);
+            if (c->buf == NULL) error();
+        }
+        ssize_t got = read(c->fd, c->buf + c->len, c->size - c->len);
+        if (got > 0) c->len += got;
+        else if (got < 0 && errno == EINTR) continue;
+        else {
+            c->done = got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
+        }
+    }
+    size_t answered = AnswerLines(c->buf, c->len, &c->out);
+    memmove(c->buf, c->buf + answered, c->len - answered);
+    c->len -= answered;
+    // A request without its newline is answered when the client stops sending; one that never ends is an error
+    if (c->len >= MAXREQUEST){
+        OutStr(&c->out, "Input error.\n", 13);
+        c->len = 0;
+        c->done = 1;
+    }
+    else if (c->done && c->len){
+        c->buf[c->len] = '\0'; // the last read found room for more
+        Answer(c->buf, &c->out);
+        c->len = 0;
+    }
+}
+
+// Sends as much of the answers as the socket takes without waiting
+// Returns 1 if some are left to send
+bool SendAnswers(Connection *c){
+    while (c->sent < c->out.len){
+        ssize_t put = send(c->fd, c->out.data + c->sent, c->out.len - c->sent, MSG_NOSIGNAL);
+        if (put >= 0) c->sent += put;
+        else if (errno == EINTR) continue;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) return 1;
+        else {
+            c->done = 1; // the client is gone, so are its answers
+            break;
+        }
+    }
+    c->out.len = c->sent = 0;
+    return 0;
+}
+
+// Makes the socket of a Unix domain server at path, replacing a socket left there by an earlier server
+int Listen(const char *path){
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(address.sun_path)) error();
+    strcpy(address.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) error();
+    unlink(path);
+    if (bind(fd, (struct sockaddr *) &address, sizeof(address)) || listen(fd, SOMAXCONN)) error();
+    NonBlocking(fd);
+    return fd;
+}
+
+// Handles "visualise --serve SOCKET [-m SLOTS]": answers the requests of any number of clients with one epoll loop,
+// until it is killed; every client is read until it has nothing more to send, and all answers to what was read
+// are sent together
+// -m keeps the text of values written before in a cache of the given number of slots, up to MAXSLOTS, shared by all clients
+void Serve(int n, char *s[n]){
+    long slots = 0;
+    if (!(n == 3 || (n == 5 && !strcmp(s[3],"-m") && (slots = Count(s[4], MAXSLOTS)) > 0))) error();
+    int listener = Listen(s[2]), ep = epoll_create1(0);
+    if (ep < 0) error();
+    struct epoll_event ev = {EPOLLIN, {.ptr = NULL}}, events[MAXEVENTS]; // the listening socket has no connection
+    if (epoll_ctl(ep, EPOLL_CTL_ADD, listener, &ev)) error();
+    Cache *cache = slots ? NewCache(slots) : NULL;
+    while (true){
+        int count = epoll_wait(ep, events, MAXEVENTS, -1);
+        if (count < 0 && errno != EINTR) error();
+        for (int i = 0; i < count; i++){
+            Connection *c = events[i].data.ptr;
+            if (c == NULL){
+                int fd;
+                while ((fd = accept(listener, NULL, NULL)) >= 0){
+                    NonBlocking(fd);
+                    c = calloc(1, sizeof(Connection));
+                    if (c == NULL) error();
+                    c->fd = fd;
+                    c->out.cache = cache;
+                    c->events = EPOLLIN;
+                    ev = (struct epoll_event) {EPOLLIN, {.ptr = c}};
+                    if (epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev)) error();
+                }
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) ReadRequests(c);
+            bool pending = SendAnswers(c);
+            if (c->done && !pending){
+                close(c->fd); // which also takes it out of the epoll set
+                free(c->buf);
+                free(c->out.data);
+                free(c);
+            }
+            else{
+                // Only wait for requests until the client has stopped sending, since a socket at its end is always
+                // ready to read, and only for room to send while there is something to send
+                unsigned events = (c->done ? 0 : EPOLLIN) | (pending ? EPOLLOUT : 0);
+                if (events == c->events) continue;
+                c->events = events;
+                ev = (struct epoll_event) {events, {.ptr = c}};
+                if (epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev)) error();
+            }
+        }
+    }
+}
+#else
+void Serve(int n, char *s[n]){
+    error(); // the server needs epoll
+}
+#endif
+
+// Handles "visualise --client SOCKET [Request]": sends the request, or else every line of stdin, to the server at SOCKET
+// and prints the answers; requests are sent as fast as they are read, without waiting for answers in between
+void Client(int n, char *s[n]){
+#ifdef POSIX
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (n < 3 || strlen(s[2]) >= sizeof(address.sun_path)) error();
+    strcpy(address.sun_path, s[2]);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &address, sizeof(address))) error();
+    // Requests waiting to be sent, of which "sent" bytes have been
+    Output requests = {NULL, 0, 0, NULL};
+    size_t sent = 0;
+    for (int i = 3; i < n; i++){
+        OutStr(&requests, s[i], strlen(s[i]));
+        OutStr(&requests, i == n-1 ? "\n" : " ", 1);
+    }
+    struct pollfd fds[2] = {{fd, POLLIN, 0}, {n > 3 ? -1 : STDIN_FILENO, POLLIN, 0}};
+    bool closed = 0; // set once every request is sent
+    char buf[READSIZE];
+    while (true){
+        if (!closed && fds[1].fd < 0 && sent == requests.len){
+            shutdown(fd, SHUT_WR); // so the server knows there are no more requests
+            closed = 1;
+        }
+        fds[0].events = POLLIN | (sent < requests.len ? POLLOUT : 0);
+        if (poll(fds, 2, -1) < 0){
+            if (errno == EINTR) continue;
+            error();
+        }
+        if (fds[1].fd >= 0 && fds[1].revents){
+            ssize_t got = read(STDIN_FILENO, buf, sizeof(buf));
+            if (got > 0) OutStr(&requests, buf, got);
+            else fds[1].fd = -1;
+        }
+        if (fds[0].revents & POLLOUT){
+            ssize_t put = send(fd, requests.data + sent, requests.len - sent, MSG_NOSIGNAL);
+            if (put < 0 && errno != EINTR) error();
+            if (put > 0 && (sent += put) == requests.len) requests.len = sent = 0;
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)){
+            ssize_t got = read(fd, buf, sizeof(buf));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) break; // the server has answered everything
+            OutStr(&out, buf, got);
+            if (out.len >= FLUSHSIZE) FlushOutput(&out);
+        }
+    }
+    free(requests.data);
+    close(fd);
+#else
+    error(); // no sockets
+#endif
+}
+// -------------------------------------------------------------------------------------------
+// Queue Functionality
+
+void InitialiseQueue(Queue *q) {
+    q->elems = NULL;
+    q->front = q->back = q->cap = 0;
+}
+
+// Makes sure the queue can hold count more elements without growing
+void ReserveQueue(Queue *q, int count){
+    if (q->back + count <= q->cap) return;
+    int cap = q->cap ? q->cap : 16;
+    while (cap < q->back + count) cap *= 2;
+    q->elems = realloc(q->elems, cap * sizeof(Elem));
+    if (q->elems == NULL) error();
+    q->cap = cap;
+}
+
+void FreeQueue(Queue *q){
+    free(q->elems);
+    InitialiseQueue(q);
+}
+
+// Adds new element to the queue
+void Push(Queue *q, int index, int type) {
+    ReserveQueue(q, 1);
+    q->elems[q->back].type = type;
+    q->elems[q->back].index = index;
+    q->back++;
+}
+
+// Saves type and index of the front of the queue then removes it from the queue
 int Pop(Queue *q, int *index, int *type){
-    Elem *curr;
     if(QueueEmpty(q)) return -1; //report value in case we try to pop an empty queue
 
-    *type = q->front->type;
-    *index = q->front->index;
-
-    curr = q->front;
-    q->front=q->front->next;
-    free(curr);
+    *type = q->elems[q->front].type;
+    *index = q->elems[q->front].index;
+    q->front++;
+    if (q->front == q->back) q->front = q->back = 0; // the queue is empty, so the array can be reused from the start
     return 0;
 }
 
 // Returns 1 if the queue is empty
 bool QueueEmpty(Queue *q){
-    if(q->front == NULL) return 1;
+    if(q->front == q->back) return 1;
     return 0;
 }
 // -------------------------------------------------------------------------------------------
@@ -316,6 +2290,7 @@ bool QueueEmpty(Queue *q){
 
 // Terminates program prematurely and prints error message
 void error(){
+    FlushOutput(&out);
     printf("Input error.\n");
     exit(1);
 }
@@ -327,14 +2302,6 @@ void assert(int line, int b) {
     exit(1);
 }
 
-// Prints binary value grouped in nibbles
-void printbinary(char *s){
-    int n=strlen(s);
-    for (int i = 0; i < n; i++){
-        printf("%c",s[i]);
-        if(i%4 == 3) printf(" ");
-    }
-}
 // -------------------------------------------------------------------------------------------
 // Testing
 // Tests 1 to 20
@@ -383,20 +2350,67 @@ void testConvertDec(){
     free (binary);
 }
 
-// Tests 34 to 45
+// Tests 34 to 45, 255
 // Tests conversion from binary to decimal
 void testConvertBin(){
-    assert(__LINE__,ConvertBin(4,(char *[]) { "", "char", "0010","1100" },2,eCHAR) == 44); 
-    assert(__LINE__,ConvertBin(6,(char *[]) { "", "{char;char}", "0010","1100", "0011","1111" },4,eCHAR) == 63); 
-    assert(__LINE__,ConvertBin(7,(char *[]) {"","{unsigned", "char;char}", "0001", "0000", "1000", "0110"},3,eCHAR) == 16); 
-    assert(__LINE__,ConvertBin(7,(char *[]) {"","{unsigned", "char;char}", "0001", "0000", "1000", "0000"},5,eCHAR) == -128); 
-    assert(__LINE__,ConvertBin(18,(char *[]) {"","long", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111"},2,eLONG) == -1);
-    assert(__LINE__,ConvertBin(20,(char *[]) {"","{char;long}","1111","0111", "1000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000"},4,eLONG) == LLONG_MIN);
-    assert(__LINE__,ConvertBin(18,(char *[]) {"","long", "0111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111"},2,eLONG) == LLONG_MAX);
-    assert(__LINE__,ConvertBin(4,(char *[]) { "", "char", "0000","0000" },2,eCHAR) == 0); 
-    assert(__LINE__,ConvertBin(4,(char *[]) { "", "char", "1111","1111" },2,eCHAR) == -1); 
-    assert(__LINE__,ConvertBin(4,(char *[]) { "", "char", "1000","0000" },2,eCHAR) == CHAR_MIN); 
-    assert(__LINE__,ConvertBin(4,(char *[]) { "", "char", "0000","0000" },2,eCHAR) == 0);    
+    bool valid = true;
+    assert(__LINE__,ConvertBin(4,(char *[]) { "", "char", "0010","1100" },2,&valid,eCHAR) == 44); 
+    assert(__LINE__,ConvertBin(6,(char *[]) { "", "{char;char}", "0010","1100", "0011","1111" },4,&valid,eCHAR) == 63); 
+    assert(__LINE__,ConvertBin(7,(char *[]) {"","{unsigned", "char;char}", "0001", "0000", "1000", "0110"},3,&valid,eCHAR) == 16); 
+    assert(__LINE__,ConvertBin(7,(char *[]) {"","{unsigned", "char;char}", "0001", "0000", "1000", "0000"},5,&valid,eCHAR) == -128); 
+    assert(__LINE__,ConvertBin(18,(char *[]) {"","long", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111"},2,&valid,eLONG) == -1);
+    assert(__LINE__,ConvertBin(20,(char *[]) {"","{char;long}","1111","0111", "1000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000", "0000"},4,&valid,eLONG) == LLONG_MIN);
+    assert(__LINE__,ConvertBin(18,(char *[]) {"","long", "0111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111", "1111"},2,&valid,eLONG) == LLONG_MAX);
+    assert(__LINE__,ConvertBin(4,(char *[]) { "", "char", "0000","0000" },2,&valid,eCHAR) == 0); 
+    assert(__LINE__,ConvertBin(4,(char *[]) { "", "char", "1111","1111" },2,&valid,eCHAR) == -1); 
+    assert(__LINE__,ConvertBin(4,(char *[]) { "", "char", "1000","0000" },2,&valid,eCHAR) == CHAR_MIN); 
+    assert(__LINE__,ConvertBin(4,(char *[]) { "", "char", "0000","0000" },2,&valid,eCHAR) == 0);    
+    assert(__LINE__,valid && (ConvertBin(4,(char *[]) { "", "char", "0010","1120" },2,&valid,eCHAR), !valid));
+}
+
+// Tests 110 to 122
+// Tests parsing nibbles into values of every type
+void testParseBinary(){
+    Value value = 0;
+    assert(__LINE__,ParseNibble("0000") == 0 && ParseNibble("1111") == 15 && ParseNibble("1000") == 8 && ParseNibble("0110") == 6);
+    assert(__LINE__,ParseNibble("010") == -1 && ParseNibble("01100") == -1 && ParseNibble("") == -1);
+    assert(__LINE__,ParseNibble("0120") == -1 && ParseNibble("/111") == -1 && ParseNibble("111q") == -1);
+    assert(__LINE__,ParseBinary((char *[]) {"1000","0000"},eUCHAR,&value) && value == 128);
+    assert(__LINE__,ParseBinary((char *[]) {"1111","1111","1111","1111","1111","1111","1111","1110"},eINT,&value) && value == -2);
+    assert(__LINE__,ParseBinary((char *[]) {"1111","1111","1111","1111","1111","1111","1111","1110"},eUINT,&value) && value == 4294967294LL);
+    assert(__LINE__,ParseBinary((char *[]) {"0000","0001","0010","0011","0100","0101","0110","0111",
+                                            "1000","1001","1010","1011","1100","1101","1110","1111"},eLONG,&value) && value == 0x0123456789ABCDEF);
+    assert(__LINE__,!ParseBinary((char *[]) {"0000","0000","0000","0000","0000","0000","0000","000"},eINT,&value));
+    assert(__LINE__,!ParseBinary((char *[]) {"0000","0000","0000","0000","0000","0200","0000","0000"},eINT,&value));
+    assert(__LINE__,!ParseBinary((char *[]) {"0000","00001"},eCHAR,&value));
+    assert(__LINE__,ParseGrouped("1111 1110\n",eCHAR,&value) && value == -2);
+    assert(__LINE__,ParseGrouped("0000 0000 0000 0000 0000 0000 1111 1110 ",eINT,&value) && value == 254);
+    assert(__LINE__,!ParseGrouped("1111 1110",eCHAR,&value) && !ParseGrouped("1111  1110 ",eCHAR,&value) && !ParseGrouped("1111 1120 ",eCHAR,&value));
+}
+
+// Tests 123 to 141
+// Tests parsing decimal values, checking their digits and limits
+void testParseDec(){
+    Value value = 0;
+    assert(__LINE__,ParseDec("0",1,eCHAR,&value) && value == 0);
+    assert(__LINE__,!ParseDec("-0",2,eCHAR,&value) && value == 0);
+    assert(__LINE__,!ParseDec("00",2,eCHAR,&value) && value == 0);
+    assert(__LINE__,!ParseDec("",0,eCHAR,&value) && !ParseDec("-",1,eCHAR,&value));
+    assert(__LINE__,!ParseDec("+5",2,eCHAR,&value) && !ParseDec(" 5",2,eCHAR,&value) && !ParseDec("5 ",2,eCHAR,&value));
+    assert(__LINE__,ParseDec("127",3,eCHAR,&value) && value == 127);
+    assert(__LINE__,!ParseDec("128",3,eCHAR,&value) && value == 128);
+    assert(__LINE__,ParseDec("-128",4,eCHAR,&value) && value == -128);
+    assert(__LINE__,!ParseDec("-1",2,eUINT,&value) && value == -1);
+    assert(__LINE__,ParseDec("4294967295",10,eUINT,&value) && value == 4294967295LL);
+    assert(__LINE__,!ParseDec("4294967296",10,eUINT,&value) && value == 4294967296LL);
+    assert(__LINE__,ParseDec("1234567890123456789",19,eLONG,&value) && value == 1234567890123456789LL);
+    assert(__LINE__,ParseDec("-9223372036854775808",20,eLONG,&value) && value == LLONG_MIN);
+    assert(__LINE__,!ParseDec("-9223372036854775809",20,eLONG,&value) && value == LLONG_MIN);
+    assert(__LINE__,!ParseDec("18446744073709551616",20,eLONG,&value) && value == LLONG_MAX);
+    assert(__LINE__,!ParseDec("123456789012345678901234567890",30,eLONG,&value) && value == LLONG_MAX);
+    assert(__LINE__,!ParseDec("1234a6789",9,eLONG,&value) && value == 1234);
+    assert(__LINE__,!ParseDec("12345678/",9,eLONG,&value) && value == 12345678);
+    assert(__LINE__,ParseDec("12345",3,eLONG,&value) && value == 123); // only len characters are read
 }
 
 // Tests 46 to 54
@@ -458,7 +2472,7 @@ void testFormatInput(){
                                                                 Pop(&q,&index,&type);   assert(__LINE__,index == 3 && type == eUCHAR);
                                                                 Pop(&q,&index,&type);   assert(__LINE__,index == 5 && type == eCHAR);
                                                                 Pop(&q,&index,&type);   assert(__LINE__,index == 7 && type == eCHAR);
-    
+    FreeQueue(&q);
 }
 
 //Tests 86 to 91
@@ -475,6 +2489,519 @@ void testQueue(){
     assert(__LINE__,(QueueEmpty(&q) == 0));
     assert(__LINE__,(Pop(&q,&x,&y)==0 && x==4 && y==3));
     assert(__LINE__,(QueueEmpty(&q) == 1));
+    FreeQueue(&q);
+}
+
+// Tests 142 to 146
+// Tests the queue keeps its order while growing and reuses its array once emptied
+void testQueueReuse(){
+    Queue q;
+    int x,y;
+    InitialiseQueue(&q);
+    for (int i = 0; i < 1000; i++) Push(&q,i,i%5);
+    bool inorder = 1;
+    for (int i = 0; i < 1000; i++) if (Pop(&q,&x,&y) != 0 || x != i || y != i%5) inorder = 0;
+    assert(__LINE__,inorder && QueueEmpty(&q));
+    assert(__LINE__,Pop(&q,&x,&y) == -1);
+    Elem *elems = q.elems;
+    int cap = q.cap;
+    Push(&q,7,eINT);
+    assert(__LINE__,q.elems == elems && q.cap == cap && q.front == 0 && q.back == 1);
+    assert(__LINE__,Pop(&q,&x,&y) == 0 && x == 7 && y == eINT);
+    ReserveQueue(&q,4000);
+    assert(__LINE__,q.cap >= 4000);
+    FreeQueue(&q);
+}
+
+// Tests 92 to 98
+// Tests encoding values into binary grouped in nibbles
+void testEncodeBinary(){
+    char text[200];
+    char *end;
+    end = EncodeBinary(7,eCHAR,text); assert(__LINE__,end - text == 10 && !memcmp(text,"0000 0111 ",10));
+    end = EncodeBinary(-72,eCHAR,text); assert(__LINE__,end - text == 10 && !memcmp(text,"1011 1000 ",10));
+    end = EncodeBinary(255,eUCHAR,text); assert(__LINE__,end - text == 10 && !memcmp(text,"1111 1111 ",10));
+    end = EncodeBinary(10000000,eINT,text); assert(__LINE__,end - text == 40 && !memcmp(text,"0000 0000 1001 1000 1001 0110 1000 0000 ",40));
+    end = EncodeBinary(-2,eLONG,text);
+    assert(__LINE__,end - text == 80 && !memcmp(text,"1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1110 ",80));
+    end = EncodeBinary(0x0123456789ABCDEF,eLONG,text);
+    assert(__LINE__,end - text == 80 && !memcmp(text,"0000 0001 0010 0011 0100 0101 0110 0111 1000 1001 1010 1011 1100 1101 1110 1111 ",80));
+    end = EncodeBinaryBatch(3,(Value []) {1,-1,UINT_MAX},eUINT,text);
+    assert(__LINE__,end - text == 120 && !memcmp(text + 40,"1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 1111 ",80));
+}
+
+// Tests 99 to 109, 154, 257 and 258
+// Tests compiling types into plans and converting streamed records
+void testStream(){
+    Plan plan, types;
+    assert(__LINE__,CompilePlan(2,(char *[]) {"","int"},&plan) == 2 && plan.count == 1 && plan.fields[0].type == eINT); FreePlan(&plan);
+    assert(__LINE__,CompilePlan(4,(char *[]) {"","unsigned","char","5"},&plan) == 3 && plan.count == 1 && plan.fields[0].type == eUCHAR);
+    FreePlan(&plan);
+    assert(__LINE__,CompilePlan(4,(char *[]) {"","{unsigned","char;long;int}","7"},&plan) == 3 && plan.count == 3 && plan.nibbles == 26);
+    assert(__LINE__,plan.fields[0].type == eUCHAR && plan.fields[1].type == eLONG && plan.fields[1].width == 16 && plan.fields[2].offset == 18);
+    FreePlan(&plan);
+    assert(__LINE__,CompilePlan(3,(char *[]) {"","{char;","int"},&plan) == -1);
+    assert(__LINE__,CompilePlan(2,(char *[]) {"","{char;float}"},&plan) == -1);
+
+    // Schemas of any length
+    int fields = 5000;
+    char *schema = malloc(fields * 5 + 2);
+    schema[0] = '{';
+    for (int i = 0; i < fields; i++) memcpy(schema + 1 + i*5, "long;", 5);
+    schema[fields * 5] = '}';
+    schema[fields * 5 + 1] = '\0';
+    assert(__LINE__,CompilePlan(2,(char *[]) {"",schema},&plan) == 2 && plan.count == fields && plan.nibbles == fields * 16);
+    FreePlan(&plan);
+    free(schema);
+
+    CompilePlan(2,(char *[]) {"","{char;unsignedchar}"},&types);
+    FILE *f = tmpfile();
+    fputs("7 128\n127   0\n\n-1\t255", f);
+    rewind(f);
+    Stream(f, NULL, 0, &types, 0);
+    char *expected = "0000 0111 1000 0000 \n0111 1111 0000 0000 \n1111 1111 1111 1111 \n";
+    assert(__LINE__,out.len == strlen(expected) && !memcmp(out.data, expected, out.len));
+    out.len = 0;
+    fclose(f);
+
+    f = tmpfile();
+    fputs("0000 0111 1000 0000\n1111 1111 1000 0000\n0000  0001\t0000 0010", f);
+    rewind(f);
+    Stream(f, NULL, 0, &types, 1);
+    expected = "7 128 \n-1 128 \n1 2 \n";
+    assert(__LINE__,out.len == strlen(expected) && !memcmp(out.data, expected, out.len));
+    out.len = 0;
+    fclose(f);
+
+    // Nibbles that are split between two blocks of the reader
+    f = tmpfile();
+    int records = READSIZE / 10 + 1;
+    for (int i = 0; i < records; i++) fputs("0000 0001\n", f);
+    rewind(f);
+    FreePlan(&types);
+    CompilePlan(2,(char *[]) {"","char"},&types);
+    Stream(f, NULL, 0, &types, 1);
+    assert(__LINE__,out.len == records * 3);
+    assert(__LINE__,!memcmp(out.data + out.len - 6, "1 \n1 \n", 6));
+    out.len = 0;
+
+    // The same input parsed in place from a memory mapped file, where it is available
+    size_t size = 0;
+    const char *map = MapFile(f, &size);
+    if (map){
+        Stream(f, map, size, &types, 1);
+        assert(__LINE__,size == (size_t) records * 10 && out.len == records * 3);
+        out.len = 0;
+        UnmapFile(map, size);
+    }
+    fclose(f);
+
+    // A token longer than a block is read whole, and with -k it is only a wrong record
+    f = tmpfile();
+    fputs("0000 0001\n", f);
+    for (int i = 0; i < READSIZE / 2; i++) fputs("0101", f);
+    fputs(" 0000\n0000 0010\n", f);
+    rewind(f);
+    types.errors = stdout;
+    assert(__LINE__,Stream(f, NULL, 0, &types, 1) == 1);
+    expected = "1 \nInput error in record 2, field 1: wrong nibble count.\n2 \n";
+    assert(__LINE__,out.len == strlen(expected) && !memcmp(out.data, expected, out.len));
+    out.len = 0;
+    fclose(f);
+    FreePlan(&types);
+}
+
+// Tests 147 to 153, 246 and 256
+// Tests splitting the input into chunks of whole records and converting them on their own
+void testChunks(){
+    long found = 0;
+    assert(__LINE__,RecordBoundary("1 2 3 4 5",9,2,&found) == 7 && found == 2);
+    assert(__LINE__,RecordBoundary("1 2 3 4 5 ",10,2,&found) == 7);
+    assert(__LINE__,RecordBoundary("1 2 3 4 5 6\n",12,2,&found) == 11 && found == 3);
+    assert(__LINE__,RecordBoundary("1 2",3,2,&found) == 0 && found == 0);
+
+    Plan plan;
+    CompilePlan(2,(char *[]) {"","{char;int}"},&plan);
+    FILE *f = tmpfile();
+    int records = CHUNKSIZE / 8;
+    for (int i = 0; i < records; i++) fputs(i % 2 ? "-1\n7 " : "-1 7\n", f); // records are split between lines
+    rewind(f);
+    Chunk c = {NULL, 0, NULL, 0, {NULL, 0, 0, NULL}, 1}, carry = {NULL, 0, NULL, 0, {NULL, 0, 0, NULL}, 1};
+    ChunkReserve(&carry, 16);
+    long converted = 0;
+    bool whole = 1;
+    while (ReadChunk(f, &c, &carry, plan.count)){
+        ConvertChunk(&c, &plan, 0);
+        whole = whole && c.ok && c.out.len % 51 == 0;
+        converted += c.out.len / 51;
+    }
+    assert(__LINE__,whole && converted == records && carry.len == 0);
+    assert(__LINE__,!memcmp(c.out.data, "1111 1111 0000 0000 0000 0000 0000 0000 0000 0111 \n", 51));
+    fclose(f);
+
+    // A wrong record keeps the ones before it
+    c.data = "1 2\n3 4\n5 x\n7 8";
+    c.len = 15;
+    ConvertChunk(&c, &plan, 0);
+    assert(__LINE__,!c.ok && c.out.len == 102);
+    free(c.buf);
+    free(c.out.data);
+    free(carry.buf);
+    FreePlan(&plan);
+    // Thread counts are whole numbers with nothing after them, up to a limit
+    assert(__LINE__,Count("8", MAXTHREADS) == 8 && !Count("2x", MAXTHREADS) && !Count("0", MAXTHREADS) && !Count("-1", MAXTHREADS)
+        && !Count(" 4", MAXTHREADS) && !Count("", MAXTHREADS) && !Count("1500000000", MAXTHREADS) && !Count("99999999999999999999", MAXTHREADS));
+    // So are cache sizes
+    assert(__LINE__,Count("1024", MAXSLOTS) == 1024 && !Count("10x", MAXSLOTS) && !Count("16777217", MAXSLOTS));
+}
+
+// Tests 155 to 162
+// Tests decoding raw records of packed or aligned fields in either byte order
+void testRaw(){
+    Plan plan;
+    CompilePlan(2,(char *[]) {"","{char;int;unsignedchar;long}"},&plan);
+    assert(__LINE__,plan.bytes == 14 && plan.fields[1].byteoffset == 1 && plan.fields[3].byteoffset == 6);
+    AlignPlan(&plan);
+    assert(__LINE__,plan.bytes == 24 && plan.fields[1].byteoffset == 4 && plan.fields[2].byteoffset == 8 && plan.fields[3].byteoffset == 16);
+
+    const unsigned char little[] = {0xFE,0x01,0x02,0x03,0x80}, big[] = {0x80,0x03,0x02,0x01};
+    assert(__LINE__,LoadRaw(little,eCHAR,0) == -2 && LoadRaw(little,eUCHAR,0) == 254);
+    assert(__LINE__,LoadRaw(little + 1,eINT,0) == (int) 0x80030201 && LoadRaw(little + 1,eUINT,0) == 0x80030201);
+    assert(__LINE__,LoadRaw(big,eINT,1) == (int) 0x80030201 && LoadRaw(big,eINT,0) == 0x01020380);
+
+    // Two packed records of {char;int} written the way a little endian machine stores them
+    FreePlan(&plan);
+    CompilePlan(2,(char *[]) {"","{char;int}"},&plan);
+    const unsigned char records[] = {0x07,0x80,0x96,0x98,0x00, 0xFF,0xFF,0xFF,0xFF,0xFF};
+    DecodeRaw(records, 2, &plan, 0, 0, &out);
+    char *expected = "7 10000000 \n-1 -1 \n";
+    assert(__LINE__,out.len == strlen(expected) && !memcmp(out.data, expected, out.len));
+    out.len = 0;
+    DecodeRaw(records, 1, &plan, 0, 1, &out);
+    expected = "0000 0111 0000 0000 1001 1000 1001 0110 1000 0000 \n";
+    assert(__LINE__,out.len == strlen(expected) && !memcmp(out.data, expected, out.len));
+    out.len = 0;
+
+    FILE *f = tmpfile();
+    fwrite(records, 1, sizeof(records), f);
+    rewind(f);
+    StreamRaw(f, NULL, 0, &plan, 0, 0);
+    assert(__LINE__,out.len == 19);
+    out.len = 0;
+    fclose(f);
+    FreePlan(&plan);
+}
+
+// Tests 163 to 175
+// Tests the short and long long types and that every type converts through its own kernels
+void testKernels(){
+    Value value = 0;
+    char text[40];
+    Plan plan;
+    assert(__LINE__,InputType("short","")==eSHORT && InputType("unsigned","short")==eUSHORT);
+    assert(__LINE__,InputType("unsignedshort","")==eUSHORT && InputType("long","long")==eLONG && InputType("longlong","")==eLONG);
+    assert(__LINE__,TypeWords("long","long","5")==2 && TypeWords("long","5","")==1 && TypeWords("unsigned","int","5")==2 && TypeWords("int","","")==1);
+    assert(__LINE__,ParseDec("-32768",6,eSHORT,&value) && value == -32768 && !ParseDec("32768",5,eSHORT,&value));
+    assert(__LINE__,ParseDec("65535",5,eUSHORT,&value) && value == 65535 && !ParseDec("-1",2,eUSHORT,&value));
+    assert(__LINE__,EncodeBinary(-2,eSHORT,text) - text == 20 && !memcmp(text,"1111 1111 1111 1110 ",20));
+    assert(__LINE__,ParseBinary((char *[]) {"1000","0000","0000","0000"},eSHORT,&value) && value == -32768);
+    assert(__LINE__,ParseBinary((char *[]) {"1000","0000","0000","0000"},eUSHORT,&value) && value == 32768);
+    assert(__LINE__,LoadRaw((unsigned char []) {0xFE,0xFF},eSHORT,0) == -2 && LoadRaw((unsigned char []) {0xFE,0xFF},eUSHORT,1) == 0xFEFF);
+    assert(__LINE__,CompilePlan(4,(char *[]) {"","long","long","5"},&plan) == 3 && plan.fields[0].type == eLONG);
+    FreePlan(&plan);
+    assert(__LINE__,CompilePlan(4,(char *[]) {"","{long","long;unsigned","short}"},&plan) == 4 && plan.count == 2 && plan.nibbles == 20
+        && plan.fields[1].type == eUSHORT && plan.fields[1].kernels == &kernels[eUSHORT]);
+    FreePlan(&plan);
+    assert(__LINE__,IsBinary(7,(char *[]) {"","unsigned","short","0000","0000","0000","0001"}));
+    assert(__LINE__,kernels[eINT].encode == EncodeBinaryInt && kernels[eLONG].parsedec == ParseDecLong);
+}
+
+// Tests 176 to 192, the last 7 only with 128 bit integers
+// Tests the fixed width names, unsigned long values above LLONG_MAX and the 128 bit types
+void testWideTypes(){
+    Value value = 0;
+    char text[200];
+    assert(__LINE__,InputType("unsigned","long")==eULONG && InputType("uint64_t","")==eULONG && InputType("unsignedlonglong","")==eULONG);
+    assert(__LINE__,InputType("signed","char")==eSCHAR && InputType("int8_t","")==eSCHAR && InputType("uint32_t","")==eUINT);
+    assert(__LINE__,TypeWords("unsigned","long","long")==3 && TypeWords("unsigned","long","5")==2 && TypeWords("signed","char","5")==2);
+    assert(__LINE__,ParseDec("18446744073709551615",20,eULONG,&value) && (unsigned long long) value == ULLONG_MAX);
+    assert(__LINE__,!ParseDec("18446744073709551616",20,eULONG,&value) && !ParseDec("-1",2,eULONG,&value));
+    assert(__LINE__,ParseDec("-128",4,eSCHAR,&value) && value == -128 && !ParseDec("128",3,eSCHAR,&value));
+    assert(__LINE__,FormatDec((Value) ULLONG_MAX,eULONG,text) - text == 20 && !memcmp(text,"18446744073709551615",20));
+    assert(__LINE__,FormatDec(LLONG_MIN,eLONG,text) - text == 20 && !memcmp(text,"-9223372036854775808",20));
+    assert(__LINE__,FormatDec(-1,eSCHAR,text) - text == 2 && FormatDec(255,eUCHAR,text) - text == 3 && !memcmp(text,"255",3));
+    assert(__LINE__,ParseBinary((char *[]) {"1111","1111","1111","1111","1111","1111","1111","1111",
+                                            "1111","1111","1111","1111","1111","1111","1111","1111"},eULONG,&value) && (unsigned long long) value == ULLONG_MAX);
+#ifdef WIDE
+    unsigned char raw[16] = {1};
+    raw[15] = 0x80;
+    assert(__LINE__,ParseDec("-170141183460469231731687303715884105728",40,eINT128,&value) && value == VALUE_MIN);
+    assert(__LINE__,!ParseDec("170141183460469231731687303715884105728",39,eINT128,&value) && value == VALUE_MAX);
+    assert(__LINE__,ParseDec("340282366920938463463374607431768211455",39,eUINT128,&value) && (UValue) value == UVALUE_MAX);
+    assert(__LINE__,!ParseDec("340282366920938463463374607431768211456",39,eUINT128,&value) && !ParseDec("-1",2,eUINT128,&value));
+    assert(__LINE__,FormatDec(VALUE_MIN,eINT128,text) - text == 40 && !memcmp(text,"-170141183460469231731687303715884105728",40));
+    assert(__LINE__,EncodeBinary(-2,eINT128,text) - text == 160 && !memcmp(text + 150,"1111 1110 ",10) && ParseGrouped(text,eINT128,&value) && value == -2);
+    assert(__LINE__,LoadRaw(raw,eINT128,0) == VALUE_MIN + 1 && LoadRaw(raw,eUINT128,1) == ((Value) 1 << 120 | 0x80));
+#endif
+}
+
+// Tests 193 to 212, 253 and 254; 211 and 212 only with 128 bit integers
+// Tests writing and reading values in hex and octal, and converting records between radixes
+void testRadix(){
+    Value value = 0;
+    char text[200];
+    assert(__LINE__,RadixNamed("hex") == eHEX && RadixNamed("oct") == eOCT && RadixNamed("bin") == eBIN && RadixNamed("HEX") == -1);
+    assert(__LINE__,EncodeHex(-1,eCHAR,text) - text == 4 && !memcmp(text,"0xff",4));
+    assert(__LINE__,EncodeHex(0x1234,eINT,text) - text == 10 && !memcmp(text,"0x00001234",10));
+    assert(__LINE__,EncodeHex(LLONG_MIN,eLONG,text) - text == 18 && !memcmp(text,"0x8000000000000000",18));
+    assert(__LINE__,EncodeOct(-1,eCHAR,text) - text == 4 && !memcmp(text,"0377",4));
+    assert(__LINE__,EncodeOct(8,eSHORT,text) - text == 7 && !memcmp(text,"0000010",7));
+    assert(__LINE__,EncodeOct(-1,eLONG,text) - text == 23 && !memcmp(text,"01777777777777777777777",23));
+    assert(__LINE__,ParseHex("0xff",4,eCHAR,&value) && value == -1 && ParseHex("FF",2,eUCHAR,&value) && value == 255);
+    assert(__LINE__,ParseHex("0x000000ff",10,eCHAR,&value) && value == -1 && !ParseHex("0x100",5,eCHAR,&value));
+    assert(__LINE__,!ParseHex("0x",2,eINT,&value) && !ParseHex("0xfg",4,eINT,&value) && !ParseHex("",0,eINT,&value));
+    assert(__LINE__,ParseHex("8000000000000000",16,eLONG,&value) && value == LLONG_MIN);
+    assert(__LINE__,ParseOct("0377",4,eCHAR,&value) && value == -1 && !ParseOct("0400",4,eCHAR,&value) && !ParseOct("08",2,eINT,&value));
+    assert(__LINE__,ParseOct("0o17",4,eUINT,&value) && value == 15 && ParseOct("1777777777777777777777",22,eULONG,&value) && (unsigned long long) value == ULLONG_MAX);
+    assert(__LINE__,ParseText(&kernels[eINT],"0x10",4,eDEC,&value) && value == 16 && ParseText(&kernels[eINT],"0o10",4,eDEC,&value) && value == 8
+        && !ParseText(&kernels[eINT],"010",3,eDEC,&value));
+    assert(__LINE__,ParseText(&kernels[eINT],"10",2,eDEC,&value) && value == 10 && ParseText(&kernels[eINT],"10",2,eHEX,&value) && value == 16);
+
+    // A record read in hex and written in octal, then a binary one written in hex
+    Plan plan;
+    CompilePlan(2,(char *[]) {"","{char;unsignedshort}"},&plan);
+    Reader r = {NULL, NULL, "0x80 ffff\n", 0, 10, 10, 1};
+    plan.output = eOCT;
+    assert(__LINE__,ConvertRecord(&r, &plan, eHEX, &out) && out.len == 14 && !memcmp(out.data,"0200 0177777 \n",out.len));
+    out.len = 0;
+    char *binary = "0111 1111 0000 0000 0000 0001 \n";
+    Reader b = {NULL, NULL, binary, 0, strlen(binary), strlen(binary), 1};
+    plan.output = eHEX;
+    assert(__LINE__,ConvertRecord(&b, &plan, eBIN, &out) && out.len == 13 && !memcmp(out.data,"0x7f 0x0001 \n",out.len));
+    out.len = 0;
+    FreePlan(&plan);
+    // Values said to be binary with -i skip IsBinary, so a wrong nibble is only found when they are parsed
+    assert(__LINE__,!Request(6,(char *[]) {"visualise","-i","bin","char","0000","0x12"},&out)
+        && !Request(6,(char *[]) {"visualise","-i","bin","char","0000","12"},&out) && out.len == 0);
+#ifdef WIDE
+    assert(__LINE__,EncodeHex(VALUE_MIN,eINT128,text) - text == 34 && !memcmp(text,"0x80000000000000000000000000000000",34)
+        && ParseHex(text,34,eINT128,&value) && value == VALUE_MIN);
+    assert(__LINE__,EncodeOct(-1,eUINT128,text) - text == 44 && !memcmp(text,"03777",5) && ParseOct(text,44,eUINT128,&value)
+        && (UValue) value == UVALUE_MAX && !ParseOct("4000000000000000000000000000000000000000000",43,eUINT128,&value));
+#endif
+    // A decimal value with a leading zero is an error, not octal, so nibbles given without -b aren't taken for values
+    assert(__LINE__,!Request(3,(char *[]) {"visualise","char","0101"},&out) && !Request(3,(char *[]) {"visualise","int","010"},&out)
+        && out.len == 0 && ValueError("0101",4,eDEC) == eDIGIT && ValueError("-01",3,eDEC) == eDIGIT && ValueError("0",1,eDEC) == eRANGE);
+    CompilePlan(2,(char *[]) {"","char"},&plan);
+    Reader nibbles = {NULL, NULL, "0000 0111\n", 0, 10, 10, 1};
+    Output side = {NULL, 0, 0, NULL};
+    char *expected = "Input error in record 1, field 1: bad digit.\nInput error in record 2, field 1: bad digit.\n";
+    assert(__LINE__,ConvertRecords(&nibbles, &plan, eDEC, &out, &side, 0) == 2 && out.len == 0
+        && side.len == strlen(expected) && !memcmp(side.data, expected, side.len));
+    free(side.data);
+    FreePlan(&plan);
+}
+
+// Tests 213 to 221
+// Tests the decimal table of 8 bit values and writing values through the cache
+void testCache(){
+    char text[48];
+    assert(__LINE__,FormatDec(-128,eCHAR,text) - text == 4 && !memcmp(text,"-128",4) && FormatDec(7,eSCHAR,text) - text == 1 && text[0] == '7');
+    assert(__LINE__,FormatDec(255,eUCHAR,text) - text == 3 && !memcmp(text,"255",3) && FormatDec(-10,eCHAR,text) - text == 3 && !memcmp(text,"-10",3));
+    Cache *c = NewCache(5);
+    assert(__LINE__,c->mask == 7 && c->hits == 0 && c->misses == 0);
+    Output o = {NULL, 0, 0, c};
+    OutValue(&o, &kernels[eINT], -5, eDEC, 8);
+    OutValue(&o, &kernels[eINT], -5, eDEC, 8);
+    OutValue(&o, &kernels[eINT], -5, eHEX, 8);
+    assert(__LINE__,c->hits == 1 && c->misses == 2 && o.len == 17 && !memcmp(o.data,"-5 -5 0xfffffffb ",o.len));
+    // The same bits are a different value in another type
+    OutValue(&o, &kernels[eUINT], (unsigned) -5, eDEC, 8);
+    assert(__LINE__,c->misses == 3 && o.len == 28 && !memcmp(o.data + 17,"4294967291 ",11));
+    // 8 bit values and binary output don't go through the cache
+    OutValue(&o, &kernels[eCHAR], 1, eDEC, 2);
+    OutValue(&o, &kernels[eSHORT], 1, eBIN, 4);
+    assert(__LINE__,c->hits == 1 && c->misses == 3 && o.len == 50);
+    FreeCache(c);
+    // A cache of one slot only ever holds the last value, but every value is still written right
+    o.cache = c = NewCache(1);
+    o.len = 0;
+    for (int i = 0; i < 4; i++) OutValue(&o, &kernels[eLONG], i % 2 ? LLONG_MIN : 42, eDEC, 16);
+    assert(__LINE__,c->hits == 0 && c->misses == 4 && o.len == 48 && !memcmp(o.data,"42 -9223372036854775808 42 -9223372036854775808 ",o.len));
+    FreeCache(c);
+    free(o.data);
+
+    // Records streamed with a cache give the same output as without
+    Plan plan;
+    CompilePlan(2,(char *[]) {"","{int;unsignedlong}"},&plan);
+    char *binary = "1111 1111 1111 1111 1111 1111 1111 1111 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 0000 1001 \n";
+    Reader r = {NULL, NULL, binary, 0, strlen(binary), strlen(binary), 1}, again = r;
+    out.cache = NewCache(64);
+    assert(__LINE__,ConvertRecord(&r, &plan, eBIN, &out) && ConvertRecord(&again, &plan, eBIN, &out) && out.cache->hits == 2 && out.cache->misses == 2);
+    assert(__LINE__,out.len == 12 && !memcmp(out.data,"-1 9 \n-1 9 \n",out.len));
+    out.len = 0;
+    FreeCache(out.cache);
+    out.cache = NULL;
+    FreePlan(&plan);
+}
+
+// Tests 222 to 230
+// Tests telling what is wrong with a record and where, and going on past wrong records
+void testErrors(){
+    assert(__LINE__,ValueError("12a",3,eDEC) == eDIGIT && ValueError("-",1,eDEC) == eDIGIT && ValueError("300",3,eDEC) == eRANGE);
+    assert(__LINE__,ValueError("0x1ff",5,eDEC) == eRANGE && ValueError("09",2,eDEC) == eDIGIT && ValueError("fg",2,eHEX) == eDIGIT);
+    Output o = {NULL, 0, 0, NULL};
+    DescribeError(&o, (Fault) {3, 2, eDIGIT});
+    DescribeError(&o, (Fault) {4, 0, eSCHEMA});
+    char *expected = "Input error in record 3, field 2: bad digit.\nInput error in record 4: record does not match the schema.\n";
+    assert(__LINE__,o.len == strlen(expected) && !memcmp(o.data, expected, o.len));
+    free(o.data);
+
+    // Without somewhere to describe them the first wrong record stops the conversion, and the reader tells where it is
+    Plan plan;
+    CompilePlan(2,(char *[]) {"","{char;char}"},&plan);
+    char *text = "1 x 300 4\n5 6 7\n";
+    Reader r = {NULL, NULL, text, 0, strlen(text), strlen(text), 1}, again = r;
+    assert(__LINE__,ConvertRecords(&r, &plan, eDEC, &out, NULL, 0) == 1 && out.len == 0 && r.record == 1 && r.field == 2 && r.code == eDIGIT);
+    // Otherwise each wrong record is skipped as a whole, so the next one is read from its first value
+    assert(__LINE__,ConvertRecords(&again, &plan, eDEC, &out, &out, 0) == 3 && again.record == 4);
+    expected = "Input error in record 1, field 2: bad digit.\nInput error in record 2, field 1: value out of range.\n"
+               "0000 0101 0000 0110 \nInput error in record 4, field 2: record does not match the schema.\n";
+    assert(__LINE__,out.len == strlen(expected) && !memcmp(out.data, expected, out.len));
+    out.len = 0;
+    // Binary records with a nibble of the wrong length or a wrong digit
+    text = "0000 00001 0000 0000 0000 0002 0000 0000 0000 0001 0000 0010\n";
+    Reader b = {NULL, NULL, text, 0, strlen(text), strlen(text), 1};
+    Output side = {NULL, 0, 0, NULL};
+    assert(__LINE__,ConvertRecords(&b, &plan, eBIN, &out, &side, 0) == 2 && out.len == 5 && !memcmp(out.data, "1 2 \n", 5));
+    expected = "Input error in record 1, field 1: wrong nibble count.\nInput error in record 2, field 1: bad digit.\n";
+    assert(__LINE__,side.len == strlen(expected) && !memcmp(side.data, expected, side.len));
+    out.len = 0;
+    free(side.data);
+    // Records of a chunk are counted from the number of records before it
+    Chunk c = {"1 2 3 zz", 8, NULL, 0, {NULL, 0, 0, NULL}, 1, 40};
+    ConvertChunk(&c, &plan, eDEC);
+    assert(__LINE__,!c.ok && c.wrong == 1 && c.fault.record == 42 && c.fault.field == 2 && c.fault.code == eDIGIT && c.out.len == 21);
+    free(c.out.data);
+    FreePlan(&plan);
+}
+
+// Tests 231 to 238
+// Tests answering requests the way the server does, several to a buffer, with errors answered and not fatal
+void testServer(){
+    Output o = {NULL, 0, 0, NULL};
+    char *args[] = {"visualise", "int", "5"};
+    assert(__LINE__,Request(3, args, &o) && o.len == 41 && !memcmp(o.data, "0000 0000 0000 0000 0000 0000 0000 0101 \n", 41));
+    o.len = 0;
+    char *wrong[] = {"visualise", "char", "300"};
+    assert(__LINE__,!Request(3, wrong, &o) && o.len == 0);
+    char *missing[] = {"visualise", "int"};
+    assert(__LINE__,!Request(2, missing, &o) && o.len == 0);
+    char line[] = " -O hex\t{char;int}  7 5\r";
+    Answer(line, &o);
+    assert(__LINE__,o.len == 17 && !memcmp(o.data, "0x07 0x00000005 \n", 17));
+    o.len = 0;
+    // Whole lines are answered in order and a line that hasn't fully arrived is left for later
+    char buf[] = "char 1000 0000\nfloat 1\nunsigned char 200\nchar 7";
+    size_t answered = AnswerLines(buf, strlen(buf), &o);
+    char *expected = "-128 \nInput error.\n1100 1000 \n";
+    assert(__LINE__,answered == 41 && !strcmp(buf + answered, "char 7"));
+    assert(__LINE__,o.len == strlen(expected) && !memcmp(o.data, expected, o.len));
+    o.len = 0;
+    assert(__LINE__,AnswerLines(buf + answered, strlen(buf + answered), &o) == 0 && o.len == 0);
+    // Answers go through the cache like any output written in hex, octal or decimal
+    o.cache = NewCache(64);
+    char again[] = "-O hex int 5\n-O hex int 5\n";
+    AnswerLines(again, strlen(again), &o);
+    assert(__LINE__,o.len == 24 && o.cache->hits == 1 && o.cache->misses == 1);
+    FreeCache(o.cache);
+    free(o.data);
+}
+
+// Tests 239 to 245
+// Tests decimal text made two digits at a time and every layout of streaming output
+void testLayouts(){
+    char text[48];
+    *FormatDec(-1000000007, eINT, text) = '\0';
+    assert(__LINE__,!strcmp(text, "-1000000007") && !memcmp(digitpairs[7], "07", 2) && !memcmp(digitpairs[99], "99", 2));
+    *FormatDec(10, eUSHORT, text) = '\0';
+    assert(__LINE__,!strcmp(text, "10") && FormatDec(9, eUSHORT, text) - text == 1 && FormatDec(100, eUSHORT, text) - text == 3);
+#ifdef WIDE
+    *FormatDec(VALUE_MIN, eINT128, text) = '\0';
+    assert(__LINE__,!strcmp(text, "-170141183460469231731687303715884105728"));
+#endif
+    Plan plan;
+    CompilePlan(2,(char *[]) {"","{char;int;unsignedchar}"},&plan);
+    char *layouts[] = {"lines", "csv", "tsv", "fixed"};
+    char *expected[] = {"7\n-1\n255\n-128\n100000\n0\n", "7,-1,255\n-128,100000,0\n", "7\t-1\t255\n-128\t100000\t0\n",
+                        "   7          -1 255\n-128      100000   0\n"};
+    plan.output = eDEC;
+    for (int i = 0; i < 4; i++){
+        LayoutPlan(&plan, LayoutNamed(layouts[i]), eDEC);
+        char *input = "7 -1 255\n-128 100000 0\n";
+        Reader r = {NULL, NULL, input, 0, strlen(input), strlen(input), 1};
+        ConvertRecords(&r, &plan, eDEC, &out, NULL, 0);
+        assert(__LINE__,out.len == strlen(expected[i]) && !memcmp(out.data, expected[i], out.len));
+        out.len = 0;
+    }
+    // Fixed width text is as wide as the longest limit of the type, which in hex or binary is that of every value
+    LayoutPlan(&plan, eFIXED, eHEX);
+    assert(__LINE__,plan.fields[0].textwidth == 4 && plan.fields[1].textwidth == 10 && LayoutNamed("columns") == -1);
+    LayoutPlan(&plan, eFIXED, eBIN);
+    assert(__LINE__,plan.fields[1].textwidth == 39 && plan.fields[2].textwidth == 9);
+    FreePlan(&plan);
+    assert(__LINE__,plan.layout == eSPACED);
+}
+
+// Tests 247 to 252
+// Tests the latency histogram, counting wrong records and bytes read with --stats, and the JSON it writes
+void testStats(){
+    Stats counters = {0};
+    stats = &counters;
+    // Bucket i counts blocks shorter than 2^i microseconds, the last one any longer
+    Latency(0);
+    Latency(1e-6);
+    Latency(2e-6);
+    Latency(3e-6);
+    Latency(1024e-6);
+    Latency(1e9);
+    assert(__LINE__,counters.latency[0] == 1 && counters.latency[1] == 1 && counters.latency[2] == 2 && counters.latency[3] == 0);
+    assert(__LINE__,counters.latency[10] == 0 && counters.latency[11] == 1 && counters.latency[LATENCYBUCKETS - 1] == 1);
+
+    Plan plan;
+    CompilePlan(2,(char *[]) {"","{char;int}"},&plan);
+    char *text = "1 2\n300 4\n5 x\n6\n";
+    Reader r = {NULL, NULL, text, 0, strlen(text), strlen(text), 1};
+    Output side = {NULL, 0, 0, NULL};
+    assert(__LINE__,ConvertRecords(&r, &plan, eDEC, &out, &side, 0) == 3);
+    assert(__LINE__,counters.errors[eRANGE] == 1 && counters.errors[eDIGIT] == 1 && counters.errors[eSCHEMA] == 1 && counters.errors[eNIBBLES] == 0);
+    out.len = side.len = 0;
+    free(side.data);
+    // Stream counts the records and the bytes it reads
+    FILE *f = tmpfile();
+    fputs("7 8\n9 10\n", f);
+    rewind(f);
+    memset(&counters, 0, sizeof(counters));
+    counters.start = counters.lap = Seconds();
+    assert(__LINE__,Stream(f, NULL, 0, &plan, eDEC) == 0 && counters.records == 2 && counters.bytesin == 9);
+    out.len = 0;
+    fclose(f);
+
+    // The JSON names the types of the right records' values, and the errors
+    counters.wrong = 1;
+    counters.errors[eDIGIT] = 1;
+    f = tmpfile();
+    WriteStats(f, &plan, 2, NULL);
+    char json[1024];
+    rewind(f);
+    size_t len = fread(json, 1, sizeof(json) - 1, f);
+    json[len] = '\0';
+    assert(__LINE__,!strncmp(json, "{\"threads\": 2, \"seconds\": {\"total\": ", 36) && strstr(json, "\"bytes\": {\"in\": 9, \"out\": 0}, \"records\": 2, \"wrong\": 1, \"values\": 2,")
+        && strstr(json, "\"types\": {\"char\": 1, \"int\": 1},") && strstr(json, "\"bad digit\": 1, \"wrong nibble count\": 0")
+        && !strstr(json, "\"cache\"") && strstr(json, "\"block_latency_us\": [") && !strcmp(json + len - 3, "]}\n"));
+    fclose(f);
+    FreePlan(&plan);
+    stats = NULL;
 }
 
 // Run the tests
@@ -482,10 +3009,25 @@ void test(){
     testConvertDecStr();
     testConvertDec();
     testConvertBin();
+    testParseBinary();
+    testParseDec();
     testInputType();
     testIsBinary();
     testQueue();
+    testQueueReuse();
     testFormatInput();
+    testEncodeBinary();
+    testStream();
+    testChunks();
+    testRaw();
+    testKernels();
+    testWideTypes();
+    testRadix();
+    testCache();
+    testErrors();
+    testServer();
+    testLayouts();
+    testStats();
     printf("All tests pass.\n");
     exit(1);
 }
@@ -493,13 +3035,10 @@ void test(){
 // Run the program or, if there are no arguments, test it
 int main(int n, char *args[n]) {
     if(n == 1) test();
-    if(n == 2) error(); //not enough arguments
-    else{
-        bool b = IsBinary(n,args); //checks if input is in binary form or not
-        Queue q; //Queue which will hold data that will be manipulated
-        InitialiseQueue(&q);
-        FormatInput(n, args, b, &q);
-        Solve(n, args, b, &q);
-    } 
+    if(!strcmp(args[1],"-f") || !strcmp(args[1],"-r")) RunStream(n, args); // values come from a file instead of args
+    else if(!strcmp(args[1],"--serve")) Serve(n, args); // values come from clients over a socket
+    else if(!strcmp(args[1],"--client")) Client(n, args);
+    else if(!Request(n, args, &out)) error();
+    FlushOutput(&out);
     return 0;
 }